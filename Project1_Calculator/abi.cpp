@@ -11,8 +11,58 @@ struct c_bigdecimal {
     BigDecimal *inner;
 };
 
-const int MAX_LENGTH = 5000000;
-char buffer[MAX_LENGTH * 2];
+// all the functions are reentrant, and can be called from many threads at the same time, as long as a handle is not
+// written by one thread while others are using it. the exceptions are the `set_*` functions, which change the global
+// settings, and should be called before any multiplication.
+//
+// strings are written to the buffers owned by the caller: call `*_string_length` to get the length (without the null
+// character), then `write_*_string` with a buffer of at least length + 1 bytes.
+
+// 0 for auto, 1 for FFT, 2 for NTT, same order as `MultiplyEngine`
+void set_multiply_engine(int engine) {
+    multiply_engine = static_cast<MultiplyEngine>(engine);
+}
+
+// limit the memory (in bytes) of the process-wide FFT root table
+void set_fft_cache_limit(size_t bytes) {
+    FFTRootTable::set_memory_limit(bytes);
+}
+
+// limit the memory (in bytes) of the transforms of one exact product, the longer ones are kept in temporary files
+void set_transform_memory_limit(size_t bytes) {
+    transform_memory_limit = bytes;
+}
+
+// number of threads used by the multiplication of huge numbers, should not be called during a multiplication
+void set_multiply_threads(size_t threads) {
+    set_thread_count(threads);
+}
+
+// start (nonzero) or stop (0) collecting the statistics of the multiplications, like `mul --stats`
+void set_multiply_stats(int enabled) {
+    stats_enabled = enabled != 0;
+}
+
+void reset_multiply_stats() {
+    multiply_stats.reset();
+}
+
+// the statistics collected since the last reset, in the same format as `mul --stats`, one "name: value" per line.
+// the same buffer convention as `write_integer_string`
+size_t write_multiply_stats(char *buffer, size_t capacity) {
+    string report = multiply_stats.report();
+    if (report.size() < capacity) {
+        copy(report.begin(), report.end(), buffer);
+        buffer[report.size()] = '\0';
+    }
+    return report.size();
+}
+
+// the number of FFT products whose rounding error exceeded `fft_error_bound`, and were redone by NTT. it's counted
+// even if the statistics are disabled, and cleared by `reset_multiply_stats`
+uint64_t fft_fallback_count() {
+    return multiply_stats.fft_fallbacks();
+}
 
 c_biginteger *create_biginteger(const char *number) {
     auto *res = new c_biginteger;
@@ -32,10 +82,25 @@ c_biginteger *integer_multiplication(c_biginteger *lhs, c_biginteger *rhs) {
     return ptr;
 }
 
-char *integer_string(c_biginteger *integer) {
-    string s = integer->inner->get_number_string();
-    strncpy(buffer, s.c_str(), sizeof(buffer) - 1);
-    return buffer;
+// multiply into the existing handle `result`, reusing its memory, `result` can be the same as `lhs` or `rhs`
+void integer_multiply_into(c_biginteger *result, const c_biginteger *lhs, const c_biginteger *rhs) {
+    BigInteger::multiply_into(*lhs->inner, *rhs->inner, *result->inner);
+}
+
+// the digits of the absolute value, which may have leading zeros (see `BigInteger::get_number_string`)
+size_t integer_string_length(const c_biginteger *integer) {
+    return integer->inner->number_string_length();
+}
+
+// write the string and a null character to `buffer` of `capacity` bytes, nothing is written if `capacity` is not
+// enough. returns the length of the string, so that the caller can retry with a larger buffer
+size_t write_integer_string(const c_biginteger *integer, char *buffer, size_t capacity) {
+    size_t length = integer->inner->number_string_length();
+    if (length < capacity) {
+        integer->inner->write_digits(0, length, buffer);
+        buffer[length] = '\0';
+    }
+    return length;
 }
 
 void delete_integer(c_biginteger *ptr) {
@@ -61,11 +126,66 @@ c_bigdecimal *decimal_multiplication(c_bigdecimal *lhs, c_bigdecimal *rhs) {
     return ptr;
 }
 
-char *decimal_string(c_bigdecimal *ptr) {
-    ostringstream ss;
-    ss << *ptr->inner;
-    strncpy(buffer, ss.str().c_str(), sizeof(buffer) - 1);
-    return buffer;
+void decimal_multiply_into(c_bigdecimal *result, const c_bigdecimal *lhs, const c_bigdecimal *rhs) {
+    BigDecimal::multiply_into(*lhs->inner, *rhs->inner, *result->inner);
+}
+
+// multiply `count` pairs, `results[i] = lhs[i] * rhs[i]`, into the existing handles, reusing their memory.
+// the pairs are distributed to the threads of the multiplication (see `set_multiply_threads`), and every thread
+// keeps its working memory across the pairs and the calls
+void batch_multiply(c_bigdecimal *const *results, const c_bigdecimal *const *lhs, const c_bigdecimal *const *rhs,
+                    size_t count) {
+    thread_pool().parallel_for(count, [=](size_t i) {
+        thread_local MultiplyScratch scratch;
+        BigDecimal::multiply_into(*lhs[i]->inner, *rhs[i]->inner, *results[i]->inner, scratch);
+    });
+}
+
+// the product of `count` factors (1 if `count` is 0) by a product tree, see `BigInteger::multiply_all`
+c_biginteger *integer_multiply_all(const c_biginteger *const *factors, size_t count) {
+    vector<BigInteger> integers;
+    integers.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+        integers.push_back(*factors[i]->inner);
+    auto *ptr = new c_biginteger;
+    ptr->inner = new BigInteger(BigInteger::multiply_all(std::move(integers)));
+    return ptr;
+}
+
+c_bigdecimal *decimal_multiply_all(const c_bigdecimal *const *factors, size_t count) {
+    vector<BigDecimal> decimals;
+    decimals.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+        decimals.push_back(*factors[i]->inner);
+    auto *ptr = new c_bigdecimal;
+    ptr->inner = new BigDecimal(BigDecimal::multiply_all(decimals));
+    return ptr;
+}
+
+// the sum of lhs[i] * rhs[i] for `count` pairs, see `BigDecimal::dot_product`
+c_bigdecimal *decimal_dot_product(const c_bigdecimal *const *lhs, const c_bigdecimal *const *rhs, size_t count) {
+    vector<BigDecimal> x, y;
+    x.reserve(count);
+    y.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        x.push_back(*lhs[i]->inner);
+        y.push_back(*rhs[i]->inner);
+    }
+    auto *ptr = new c_bigdecimal;
+    ptr->inner = new BigDecimal(BigDecimal::dot_product(x, y));
+    return ptr;
+}
+
+// in fixed notation
+size_t decimal_string_length(const c_bigdecimal *ptr) {
+    return ptr->inner->format_to(nullptr, 0, false, 0);
+}
+
+size_t write_decimal_string(const c_bigdecimal *ptr, char *buffer, size_t capacity) {
+    size_t length = ptr->inner->format_to(buffer, capacity == 0 ? 0 : capacity - 1, false, 0);
+    if (length < capacity)
+        buffer[length] = '\0';
+    return length;
 }
 
 void delete_decimal(c_bigdecimal *ptr) {
@@ -2,8 +2,11 @@ from decimal import Decimal
 from time import perf_counter
 import ctypes
 import decimal
+import math
 import os
 import random
+import sys
+import threading
 import unittest
 
 
@@ -11,6 +14,13 @@ class ABIException(Exception):
     pass
 
 
+def read_string(length_function, write_function, address):
+    # the string is written to a buffer owned by us, so it's safe to be called from many threads
+    buffer = ctypes.create_string_buffer(length_function(address) + 1)
+    write_function(address, buffer, len(buffer))
+    return buffer.value.decode()
+
+
 class BigInteger(ctypes.Structure):
     def __init__(self, address):
         super(BigInteger, self).__init__()
@@ -25,8 +35,11 @@ class BigInteger(ctypes.Structure):
     def __mul__(self, other):
         return BigInteger(lib.integer_multiplication(self.address, other.address))
 
+    def multiply_into(self, lhs, rhs):
+        lib.integer_multiply_into(self.address, lhs.address, rhs.address)
+
     def __repr__(self):
-        return lib.integer_string(self.address).decode()
+        return read_string(lib.integer_string_length, lib.write_integer_string, self.address)
 
     def __del__(self):
         lib.delete_integer(self.address)
@@ -46,8 +59,11 @@ class BigDecimal(ctypes.Structure):
     def __mul__(self, other):
         return BigDecimal(lib.decimal_multiplication(self.address, other.address))
 
+    def multiply_into(self, lhs, rhs):
+        lib.decimal_multiply_into(self.address, lhs.address, rhs.address)
+
     def __repr__(self):
-        return lib.decimal_string(self.address).decode()
+        return read_string(lib.decimal_string_length, lib.write_decimal_string, self.address)
 
     def __del__(self):
         lib.delete_decimal(self.address)
@@ -110,14 +126,121 @@ class CorrectnessTest(unittest.TestCase):
 
             print(f'BigDecimal, Length {length}, time = {duration * 1000:.2f} ms, Correct')
 
+    def test_concurrent_multiply_into(self):
+        def gen_integer(n):
+            return ''.join([str(random.randint(1, 9))] + [str(random.randint(0, 9)) for _ in range(n - 1)])
+
+        if hasattr(sys, 'set_int_max_str_digits'):
+            sys.set_int_max_str_digits(0)  # the results are compared as Python integers
+
+        # every thread multiplies into its own result handle repeatedly, while the operands are shared
+        operands = [gen_integer(random.randint(1, 30000)) for _ in range(8)]
+        integers = [BigInteger.new(operand) for operand in operands]
+        expected = [int(lhs) * int(rhs) for lhs, rhs in zip(operands, operands[1:])]
+        results = [BigInteger.new('0') for _ in expected]
+        failures = []
+
+        def worker(i):
+            for _ in range(5):
+                results[i].multiply_into(integers[i], integers[i + 1])
+                if int(repr(results[i])) != expected[i]:
+                    failures.append(i)
+
+        threads = [threading.Thread(target=worker, args=(i,)) for i in range(len(expected))]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        self.assertEqual(failures, [])
+
+        # the result can also be one of the operands
+        integers[0].multiply_into(integers[0], integers[0])
+        self.assertEqual(int(repr(integers[0])), int(operands[0]) ** 2)
+
+        decimal_result = BigDecimal.new('0')
+        decimal_result.multiply_into(BigDecimal.new('-1.5'), BigDecimal.new('2.5e-3'))
+        self.assertEqual(repr(decimal_result), '-0.00375')
+
+    def test_batch_multiply(self):
+        lhs = [BigDecimal.new(f'{random.randint(-10 ** 30, 10 ** 30)}e{random.randint(-20, 20)}') for _ in range(100)]
+        rhs = [BigDecimal.new(f'{random.randint(-10 ** 30, 10 ** 30)}e{random.randint(-20, 20)}') for _ in range(100)]
+        results = [BigDecimal.new('0') for _ in lhs]
+
+        def addresses(decimals):
+            return (ctypes.POINTER(BigDecimal) * len(decimals))(*[d.address for d in decimals])
+
+        lib.batch_multiply(addresses(results), addresses(lhs), addresses(rhs), ctypes.c_size_t(len(results)))
+        for x, y, result in zip(lhs, rhs, results):
+            self.assertEqual(repr(result), repr(x * y))
+
+    def test_multiply_all(self):
+        if hasattr(sys, 'set_int_max_str_digits'):
+            sys.set_int_max_str_digits(0)
+
+        def addresses(numbers):
+            return (ctypes.POINTER(type(numbers[0])) * len(numbers))(*[number.address for number in numbers])
+
+        factors = [random.randint(-10 ** 600, 10 ** 600) for _ in range(101)]
+        integers = [BigInteger.new(str(abs(factor))) for factor in factors]
+        product = BigInteger(lib.integer_multiply_all(addresses(integers), ctypes.c_size_t(len(integers))))
+        self.assertEqual(int(repr(product)), abs(math.prod(factors)))
+
+        decimals = [BigDecimal.new(f'{factor}e-3') for factor in factors[:10]]
+        product = BigDecimal(lib.decimal_multiply_all(addresses(decimals), ctypes.c_size_t(len(decimals))))
+        with decimal.localcontext(decimal.Context(prec=decimal.MAX_PREC)):
+            self.assertEqual(Decimal(repr(product)) * 10 ** 30, math.prod(factors[:10]))
+
+    def test_dot_product(self):
+        if hasattr(sys, 'set_int_max_str_digits'):
+            sys.set_int_max_str_digits(0)
+
+        def addresses(decimals):
+            return (ctypes.POINTER(BigDecimal) * len(decimals))(*[d.address for d in decimals])
+
+        # short and transform-length pairs, of mixed signs and exponents
+        lengths = [random.choice([5, 50, 2000, 5000]) for _ in range(20)]
+        lhs = [(random.randint(-10 ** n, 10 ** n), random.randint(-30, 30)) for n in lengths]
+        rhs = [(random.randint(-10 ** n, 10 ** n), random.randint(-30, 30)) for n in lengths]
+        lhs_decimals = [BigDecimal.new(f'{x}e{e}') for x, e in lhs]
+        rhs_decimals = [BigDecimal.new(f'{y}e{e}') for y, e in rhs]
+        result = BigDecimal(lib.decimal_dot_product(addresses(lhs_decimals), addresses(rhs_decimals),
+                                                    ctypes.c_size_t(len(lengths))))
+        expected = sum(x * y * 10 ** (e + f + 60) for (x, e), (y, f) in zip(lhs, rhs))
+        with decimal.localcontext(decimal.Context(prec=decimal.MAX_PREC)):
+            self.assertEqual(Decimal(repr(result)).scaleb(60), expected)
+
+    def test_multiply_stats(self):
+        lib.reset_multiply_stats()
+        lib.set_multiply_stats(1)
+        try:
+            BigInteger.new('9' * 10000) * BigInteger.new('8' * 10000)
+        finally:
+            lib.set_multiply_stats(0)
+
+        buffer = ctypes.create_string_buffer(lib.write_multiply_stats(None, 0) + 1)
+        lib.write_multiply_stats(buffer, len(buffer))
+        stats = dict(line.split(': ') for line in buffer.value.decode().splitlines())
+        self.assertEqual(stats['Multiplications'], '1')
+        self.assertGreater(int(stats['Transform length']), 0)
+        self.assertLess(float(stats['Max rounding error']), 0.5)
+
 
 if __name__ == '__main__':
     lib = ctypes.CDLL(os.path.join(os.getcwd(), 'libmul_abi@CMAKE_SHARED_LIBRARY_SUFFIX@'))
     lib.create_biginteger.restype = ctypes.POINTER(BigInteger)
     lib.integer_multiplication.restype = ctypes.POINTER(BigInteger)
-    lib.integer_string.restype = ctypes.c_char_p
+    lib.integer_multiply_all.restype = ctypes.POINTER(BigInteger)
+    lib.integer_string_length.restype = ctypes.c_size_t
+    lib.write_integer_string.restype = ctypes.c_size_t
+    lib.write_integer_string.argtypes = [ctypes.POINTER(BigInteger), ctypes.c_char_p, ctypes.c_size_t]
     lib.create_bigdecimal.restype = ctypes.POINTER(BigDecimal)
     lib.decimal_multiplication.restype = ctypes.POINTER(BigDecimal)
-    lib.decimal_string.restype = ctypes.c_char_p
+    lib.decimal_multiply_all.restype = ctypes.POINTER(BigDecimal)
+    lib.decimal_dot_product.restype = ctypes.POINTER(BigDecimal)
+    lib.decimal_string_length.restype = ctypes.c_size_t
+    lib.write_decimal_string.restype = ctypes.c_size_t
+    lib.write_decimal_string.argtypes = [ctypes.POINTER(BigDecimal), ctypes.c_char_p, ctypes.c_size_t]
+    lib.write_multiply_stats.restype = ctypes.c_size_t
+    lib.write_multiply_stats.argtypes = [ctypes.c_char_p, ctypes.c_size_t]
 
     unittest.main()
@@ -1,237 +1,2497 @@
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <cctype>
+#include <charconv>
+#include <chrono>
 #include <complex>
+#include <condition_variable>
+#include <cstdlib>
 #include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
 #include <iostream>
-#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <thread>
 #include <vector>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// the AVX2 / FMA kernels are compiled with the target attribute, and picked at runtime by `__builtin_cpu_supports`,
+// so the rest of the program still runs on any x86-64 CPU
+#if defined(__GNUC__) && defined(__x86_64__)
+#define HAS_AVX2_KERNEL
+#include <immintrin.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#define HAS_POSIX_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// the phase timers of `--stats` are compiled in unless it's built with -DMUL_STATS=0
+#if !defined(MUL_STATS)
+#define MUL_STATS 1
+#endif
+
 using std::cerr;
 using std::complex;
 using std::copy;
+using std::copy_n;
 using std::cout;
 using std::endl;
 using std::exception;
 using std::find;
 using std::find_if;
-using std::find_if_not;
+using std::fill_n;
+using std::max;
 using std::min;
 using std::ostream;
-using std::ostream_iterator;
 using std::string;
 using std::string_view;
+using std::swap;
 using std::transform;
 using std::vector;
 
-class number_parse_error : exception {
- public:
-    const char *reason_;
+class number_parse_error : exception {
+ public:
+    const char *reason_;
+
+    explicit number_parse_error(const char *reason) : reason_(reason) {}
+
+    [[nodiscard]] const char* what() const noexcept override {
+        return "failed to parse the input as numbers";
+    }
+};
+
+inline uint32_t uint32_bit_reverse(uint32_t t) {
+    // reverse bits using Bit Twiddling Hacks
+    // reference: https://graphics.stanford.edu/~seander/bithacks.html#ReverseParallel
+    t = ((t >> 1) & 0x55555555) | ((t & 0x55555555) << 1);
+    t = ((t >> 2) & 0x33333333) | ((t & 0x33333333) << 2);
+    t = ((t >> 4) & 0x0F0F0F0F) | ((t & 0x0F0F0F0F) << 4);
+    t = ((t >> 8) & 0x00FF00FF) | ((t & 0x00FF00FF) << 8);
+    t = ( t >> 16             ) | ( t               << 16);
+    return t;
+}
+
+// a fixed-size pool of worker threads for data-parallel loops
+//
+// `parallel_for(count, task)` calls `task(0)`, ..., `task(count - 1)`, the indices are handed out dynamically to the
+// workers and the caller itself, and it returns after all of them are done. since every index is computed by exactly
+// the same code no matter which thread runs it, the result never depends on the number of threads.
+//
+// only one `parallel_for` runs on the pool at a time. if the pool is busy (another thread is using it, or it's
+// called from inside a task), the loop simply runs sequentially on the calling thread.
+class ThreadPool {
+    vector<std::thread> workers_;
+
+    std::mutex mutex_;  // guards the fields below
+    std::condition_variable wake_, finished_;
+    const std::function<void(size_t)> *task_ = nullptr;
+    size_t count_ = 0, running_ = 0;
+    uint64_t generation_ = 0;  // increased by every `parallel_for`, so that the workers know there is a new task
+    bool stop_ = false;
+
+    std::atomic<size_t> next_{0};  // the next index to be handed out
+    std::mutex busy_;  // held by the thread running a `parallel_for`, so other threads fall back to sequential loops
+
+    // whether this thread is running a task, then a nested `parallel_for` must not touch `busy_`, which the caller
+    // of the outer loop already owns (and locking a mutex twice on the same thread is undefined behavior)
+    inline static thread_local bool in_task_ = false;
+
+    void work() {
+        in_task_ = true;
+        for (size_t i; (i = next_.fetch_add(1)) < count_; )
+            (*task_)(i);
+        in_task_ = false;
+    }
+
+    void worker_loop() {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            wake_.wait(lock, [&]() { return stop_ || generation_ != seen; });
+            if (stop_)
+                return;
+            seen = generation_;
+
+            lock.unlock();
+            work();
+            lock.lock();
+
+            if (--running_ == 0)
+                finished_.notify_one();
+        }
+    }
+
+ public:
+    // `threads` includes the calling thread, so `threads - 1` workers are created
+    explicit ThreadPool(size_t threads) {
+        for (size_t i = 1; i < threads; ++i)
+            workers_.emplace_back(&ThreadPool::worker_loop, this);
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto &worker : workers_)
+            worker.join();
+    }
+
+    [[nodiscard]] size_t size() const {
+        return workers_.size() + 1;
+    }
+
+    void parallel_for(size_t count, const std::function<void(size_t)> &task) {
+        auto sequential = [&]() {
+            for (size_t i = 0; i < count; ++i)
+                task(i);
+        };
+        if (workers_.empty() || count <= 1 || in_task_)
+            return sequential();
+
+        std::unique_lock<std::mutex> busy(busy_, std::try_to_lock);
+        if (!busy.owns_lock())
+            return sequential();
+
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            task_ = &task;
+            count_ = count;
+            next_ = 0;
+            running_ = workers_.size();
+            ++generation_;
+        }
+        wake_.notify_all();
+
+        work();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        finished_.wait(lock, [this]() { return running_ == 0; });
+    }
+};
+
+std::unique_ptr<ThreadPool> &thread_pool_instance() {
+    static std::unique_ptr<ThreadPool> pool =
+            std::make_unique<ThreadPool>(max(1U, std::thread::hardware_concurrency()));
+    return pool;
+}
+
+// the pool shared by the parallel algorithms, by default it has one thread per core
+ThreadPool &thread_pool() {
+    return *thread_pool_instance();
+}
+
+// set the number of threads used by the multiplication (including the calling thread).
+// note: it's not thread-safe, it should be called when no multiplication is running
+void set_thread_count(size_t threads) {
+    thread_pool_instance() = std::make_unique<ThreadPool>(max<size_t>(threads, 1));
+}
+
+// the phases of a multiplication that `--stats` reports separately
+enum class Phase { kParse, kDirectProduct, kTransform, kPointwise, kInverseTransform, kCarry, kFormat };
+
+constexpr size_t kPhaseCount = 7;
+constexpr const char *kPhaseNames[kPhaseCount] = {
+        "Parse", "Direct product", "Transform", "Pointwise product", "Inverse transform", "Carry", "Format"};
+
+constexpr bool kStatsCompiled = MUL_STATS != 0;
+
+// whether the statistics are collected, should be set before any multiplication (like `multiply_engine`)
+bool stats_enabled = false;
+
+// the statistics collected since the last `reset`: the wall time of every phase, summed over all the multiplications,
+// the longest transform, the largest `MultiplyScratch`, and the largest distance from an FFT coefficient to its
+// nearest integer (it must stay far below 0.5, see `fft_error_bound`). the FFT products redone by NTT, and the
+// products whose transforms went to temporary files are counted even if the statistics are disabled.
+// the fields are atomic, since the ABI may multiply on many threads at a time
+class MultiplyStats {
+    std::array<std::atomic<uint64_t>, kPhaseCount> nanoseconds_{};
+    std::atomic<uint64_t> multiplications_{0}, transform_length_{0}, scratch_bytes_{0}, fft_fallbacks_{0};
+    std::atomic<uint64_t> spilled_products_{0};
+    std::atomic<double> rounding_error_{0};
+
+    template<typename T>
+    static void update_max(std::atomic<T> &field, T value) {
+        T current = field.load(std::memory_order_relaxed);
+        while (current < value && !field.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+    }
+
+ public:
+    void add_time(Phase phase, uint64_t nanoseconds) {
+        nanoseconds_[static_cast<size_t>(phase)].fetch_add(nanoseconds, std::memory_order_relaxed);
+    }
+
+    void add_multiplication(size_t scratch_bytes) {
+        multiplications_.fetch_add(1, std::memory_order_relaxed);
+        update_max<uint64_t>(scratch_bytes_, scratch_bytes);
+    }
+
+    void add_transform(size_t length) {
+        update_max<uint64_t>(transform_length_, length);
+    }
+
+    void add_rounding_error(double error) {
+        update_max(rounding_error_, error);
+    }
+
+    void add_fft_fallback() {
+        fft_fallbacks_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] uint64_t fft_fallbacks() const {
+        return fft_fallbacks_;
+    }
+
+    void add_spilled_product() {
+        spilled_products_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] uint64_t spilled_products() const {
+        return spilled_products_;
+    }
+
+    void reset() {
+        for (auto &nanoseconds : nanoseconds_)
+            nanoseconds = 0;
+        multiplications_ = transform_length_ = scratch_bytes_ = fft_fallbacks_ = spilled_products_ = 0;
+        rounding_error_ = 0;
+    }
+
+    // one "name: value" per line
+    [[nodiscard]] string report() const {
+        std::ostringstream out;
+        out << "Multiplications: " << multiplications_ << '\n';
+        for (size_t i = 0; i < kPhaseCount; ++i)
+            out << kPhaseNames[i] << ": " << std::fixed << std::setprecision(3) << nanoseconds_[i] / 1e6 << " ms\n";
+        out << "Transform length: " << transform_length_ << '\n';
+        out << "Peak scratch size: " << scratch_bytes_ / 1024 << " KiB\n";
+        out << "Max rounding error: " << std::scientific << std::setprecision(3) << rounding_error_.load() << '\n';
+        out << "FFT fallbacks: " << fft_fallbacks_ << '\n';
+        out << "Spilled products: " << spilled_products_ << '\n';
+        return out.str();
+    }
+};
+
+MultiplyStats multiply_stats;
+
+// adds the wall time of its scope to `phase` if the statistics are enabled, and compiles to nothing if they are not
+// compiled in. the clock is read only twice per scope, so the scopes are put around whole phases, not in the loops
+class PhaseTimer {
+    using Clock = std::chrono::steady_clock;
+
+    Phase phase_;
+    bool enabled_;
+    Clock::time_point start_;
+
+ public:
+    explicit PhaseTimer(Phase phase) : phase_(phase), enabled_(kStatsCompiled && stats_enabled) {
+        if (enabled_)
+            start_ = Clock::now();
+    }
+
+    PhaseTimer(const PhaseTimer &) = delete;
+    PhaseTimer &operator=(const PhaseTimer &) = delete;
+
+    ~PhaseTimer() {
+        stop();
+    }
+
+    // end the scope early, when the next phase starts in the same block
+    void stop() {
+        if (enabled_) {
+            const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_);
+            multiply_stats.add_time(phase_, static_cast<uint64_t>(elapsed.count()));
+            enabled_ = false;
+        }
+    }
+};
+
+// process-wide cache of the roots of unity used by `FFTContext`, so that the O(n) `cos` / `sin` calls are paid only
+// once per process, instead of once per multiplication.
+//
+// only the table of the longest transform is kept, since e^{2 pi i k / n} = e^{2 pi i (k * N/n) / N}, a transform of
+// length n can read the table of length N with a stride of N / n. when a longer table is needed, the old one is reused
+// for the even entries, and it's still alive until the last context referring it is destroyed (`shared_ptr`).
+class FFTRootTable {
+ public:
+    using Table = vector<complex<double>>;
+
+ private:
+    inline static std::mutex mutex_;
+    inline static std::shared_ptr<const Table> roots_;  // roots_[k] = e^{2 pi i k / N}, for 0 <= k < N/2
+    inline static std::array<std::shared_ptr<const vector<double>>, 32> radix4_;  // `radix4(1 << k)` is radix4_[k]
+    inline static size_t memory_limit_ = std::numeric_limits<size_t>::max();
+
+    // build the table for length `n`, reusing `previous` (the table for length n / 2^j) if it's not null
+    static std::shared_ptr<const Table> build(uint32_t n, const Table *previous) {
+        auto table = std::make_shared<Table>(n >> 1);
+        uint32_t stride = previous == nullptr ? 0 : static_cast<uint32_t>(n / (previous->size() * 2));
+        for (uint32_t i = 0; i < (n >> 1); ++i) {
+            if (stride != 0 && i % stride == 0)
+                (*table)[i] = (*previous)[i / stride];
+            else
+                (*table)[i] = complex<double>(cos(2 * M_PI / n * i), sin(2 * M_PI / n * i));
+        }
+        return table;
+    }
+
+    // the same as `get`, but the caller holds `mutex_`
+    static std::shared_ptr<const Table> get_locked(uint32_t n) {
+        if (roots_ != nullptr && roots_->size() * 2 >= n)
+            return roots_;
+
+        // the table would exceed the memory limit, build a private one for the caller, but don't cache it
+        if ((n >> 1) * sizeof(complex<double>) > memory_limit_)
+            return build(n, nullptr);
+
+        roots_ = build(n, roots_.get());
+        return roots_;
+    }
+
+ public:
+    // get a table of length at least `n` (`n` should be a power of two)
+    static std::shared_ptr<const Table> get(uint32_t n) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        return get_locked(n);
+    }
+
+    // the twiddles of the radix-4 FFT of length `n`: w^{tj} for t = 1, 2, 3 and 0 <= j < n/4, where w = e^{2 pi i / n},
+    // as 6 arrays of n/4 doubles in a row: the real parts of w^j, the imaginary parts of w^j, then w^2j, and w^3j.
+    // every stage reads them with a stride, and the arrays are contiguous so that the SIMD lanes load them directly
+    static std::shared_ptr<const vector<double>> radix4(uint32_t n) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        uint32_t k = 0;
+        while ((1U << k) < n)
+            ++k;
+        if (radix4_[k] != nullptr)
+            return radix4_[k];
+
+        const auto roots = get_locked(n);
+        const uint32_t quarter = n / 4, stride = static_cast<uint32_t>(roots->size() * 2 / n);
+        auto table = std::make_shared<vector<double>>(6 * static_cast<size_t>(quarter));
+        for (uint32_t t = 1; t <= 3; ++t) {
+            double *real = table->data() + (2 * t - 2) * quarter, *imag = real + quarter;
+            for (uint32_t j = 0; j < quarter; ++j) {
+                const uint32_t index = t * j;  // w^index = -w^{index - n/2}
+                const complex<double> w = index < n / 2 ? (*roots)[index * stride]
+                                                        : -(*roots)[(index - n / 2) * stride];
+                real[j] = w.real();
+                imag[j] = w.imag();
+            }
+        }
+
+        if (table->size() * sizeof(double) <= memory_limit_)
+            radix4_[k] = table;
+        return table;
+    }
+
+    // limit the bytes that every cached table can use, and drop the cached tables that are already too large
+    static void set_memory_limit(size_t bytes) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        memory_limit_ = bytes;
+        if (roots_ != nullptr && roots_->size() * sizeof(complex<double>) > memory_limit_)
+            roots_ = nullptr;
+        for (auto &table : radix4_)
+            if (table != nullptr && table->size() * sizeof(double) > memory_limit_)
+                table = nullptr;
+    }
+};
+
+// multiply complex numbers without the NaN and infinity checks of `operator*`, which end in a library call unless
+// -ffast-math is on. everything in the transforms is finite
+inline complex<double> complex_multiply(complex<double> x, complex<double> y) {
+    return {x.real() * y.real() - x.imag() * y.imag(), x.real() * y.imag() + x.imag() * y.real()};
+}
+
+// which kernel `FFTContext::transform` runs
+//   - kAuto:   the radix-4 Stockham FFT with AVX2 and FMA (see `stockham_transform`) if the CPU supports them and the
+//              transform is at least `kStockhamMinLength` long, otherwise the radix-2 one
+//   - kRadix2: always the radix-2 FFT, which is portable, and is kept for comparison
+enum class FFTKernel { kAuto, kRadix2 };
+
+FFTKernel fft_kernel = FFTKernel::kAuto;
+
+#if defined(HAS_AVX2_KERNEL)
+// the first stage of `stockham_transform` works on 4 groups of 4 elements
+constexpr uint32_t kStockhamMinLength = 16;
+
+// whether the CPU supports the instructions of `stockham_transform`, checked only once
+inline bool cpu_has_avx2_fma() {
+    static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return supported;
+}
+
+// 4 complex numbers x * w (or x * conj(w) for the inverse transform), with their real and imaginary parts in separate
+// vectors
+template<bool kInverse>
+__attribute__((target("avx2,fma"))) inline void multiply_lanes(__m256d &x_real, __m256d &x_imag, __m256d w_real,
+                                                              __m256d w_imag) {
+    const __m256d real = kInverse ? _mm256_fmadd_pd(x_real, w_real, _mm256_mul_pd(x_imag, w_imag))
+                                  : _mm256_fmsub_pd(x_real, w_real, _mm256_mul_pd(x_imag, w_imag));
+    x_imag = kInverse ? _mm256_fmsub_pd(x_imag, w_real, _mm256_mul_pd(x_real, w_imag))
+                      : _mm256_fmadd_pd(x_real, w_imag, _mm256_mul_pd(x_imag, w_real));
+    x_real = real;
+}
+
+// 4 radix-4 butterflies in parallel: (a, b, c, d) in `real[0..3]` and `imag[0..3]` become
+//     y_t = w_t * sum_r x_r * i^{rt}    (-i instead of i for the inverse transform)
+// that is y0 = (a + c) + (b + d),  y1 = w1 ((a - c) + i (b - d)),
+//         y2 = w2 ((a + c) - (b + d)),  y3 = w3 ((a - c) - i (b - d))
+template<bool kInverse>
+__attribute__((target("avx2,fma"))) inline void radix4_butterfly(__m256d (&real)[4], __m256d (&imag)[4],
+                                                                const __m256d (&w_real)[3],
+                                                                const __m256d (&w_imag)[3]) {
+    const __m256d apc_real = _mm256_add_pd(real[0], real[2]), apc_imag = _mm256_add_pd(imag[0], imag[2]);
+    const __m256d amc_real = _mm256_sub_pd(real[0], real[2]), amc_imag = _mm256_sub_pd(imag[0], imag[2]);
+    const __m256d bpd_real = _mm256_add_pd(real[1], real[3]), bpd_imag = _mm256_add_pd(imag[1], imag[3]);
+    const __m256d bmd_real = _mm256_sub_pd(real[1], real[3]), bmd_imag = _mm256_sub_pd(imag[1], imag[3]);
+
+    // (a - c) + i (b - d), and (a - c) - i (b - d)
+    const __m256d plus_real = _mm256_sub_pd(amc_real, bmd_imag), plus_imag = _mm256_add_pd(amc_imag, bmd_real);
+    const __m256d minus_real = _mm256_add_pd(amc_real, bmd_imag), minus_imag = _mm256_sub_pd(amc_imag, bmd_real);
+
+    real[0] = _mm256_add_pd(apc_real, bpd_real), imag[0] = _mm256_add_pd(apc_imag, bpd_imag);
+    real[1] = kInverse ? minus_real : plus_real, imag[1] = kInverse ? minus_imag : plus_imag;
+    real[2] = _mm256_sub_pd(apc_real, bpd_real), imag[2] = _mm256_sub_pd(apc_imag, bpd_imag);
+    real[3] = kInverse ? plus_real : minus_real, imag[3] = kInverse ? plus_imag : minus_imag;
+#pragma GCC unroll 4
+    for (int t = 1; t < 4; ++t)
+        multiply_lanes<kInverse>(real[t], imag[t], w_real[t - 1], w_imag[t - 1]);
+}
+
+// transpose the 4 x 4 matrix whose rows are `rows[0..3]`
+__attribute__((target("avx2,fma"))) inline void transpose_lanes(__m256d (&rows)[4]) {
+    const __m256d t0 = _mm256_unpacklo_pd(rows[0], rows[1]), t1 = _mm256_unpackhi_pd(rows[0], rows[1]);
+    const __m256d t2 = _mm256_unpacklo_pd(rows[2], rows[3]), t3 = _mm256_unpackhi_pd(rows[2], rows[3]);
+    rows[0] = _mm256_permute2f128_pd(t0, t2, 0x20);
+    rows[1] = _mm256_permute2f128_pd(t1, t3, 0x20);
+    rows[2] = _mm256_permute2f128_pd(t0, t2, 0x31);
+    rows[3] = _mm256_permute2f128_pd(t1, t3, 0x31);
+}
+
+// 4 complex numbers from the interleaved `a` to `real` and `imag`: (r0, i0, r1, i1), (r2, i2, r3, i3) to
+// (r0, r1, r2, r3), (i0, i1, i2, i3)
+__attribute__((target("avx2,fma"))) inline void load_complex(const double *a, __m256d &real, __m256d &imag) {
+    const __m256d low = _mm256_loadu_pd(a), high = _mm256_loadu_pd(a + 4);
+    real = _mm256_permute4x64_pd(_mm256_unpacklo_pd(low, high), 0xd8);
+    imag = _mm256_permute4x64_pd(_mm256_unpackhi_pd(low, high), 0xd8);
+}
+
+// the reverse of `load_complex`
+__attribute__((target("avx2,fma"))) inline void store_complex(double *a, __m256d real, __m256d imag) {
+    real = _mm256_permute4x64_pd(real, 0xd8);
+    imag = _mm256_permute4x64_pd(imag, 0xd8);
+    _mm256_storeu_pd(a, _mm256_unpacklo_pd(real, imag));
+    _mm256_storeu_pd(a + 4, _mm256_unpackhi_pd(real, imag));
+}
+
+// the radix-4 stages of the Stockham FFT of length `n`. in a stage, there are `s` interleaved sub-transforms of length
+// 4m (n = 4ms), and with w = e^{2 pi i / n}
+//     y[q + s (4p + t)] = w^{tps} * sum_r x[q + s (p + rm)] * i^{rt},    for 0 <= p < m, 0 <= q < s, 0 <= t < 4
+// unlike Cooley-Tukey, the output is in order after the last stage, and no bit-reversal permutation is needed.
+// between the stages, the real parts are followed by the imaginary parts (n doubles each) in `x` and `y`.
+// reference: http://wwwa.pikara.ne.jp/okojisan/otfft-en/stockham3.html
+//
+// the first stage (s = 1) reads the interleaved input `a`, and the lanes go along p, so the outputs are transposed
+template<bool kInverse>
+__attribute__((target("avx2,fma"))) void stockham_first_stage(const double *a, double *y, uint32_t n,
+                                                             const double *table) {
+    const uint32_t m = n / 4;
+    __m256d real[4], imag[4], w_real[3], w_imag[3];
+    for (uint32_t p = 0; p < m; p += 4) {
+#pragma GCC unroll 4
+        for (uint32_t r = 0; r < 4; ++r)
+            load_complex(a + 2 * (p + r * m), real[r], imag[r]);
+#pragma GCC unroll 4
+        for (uint32_t t = 0; t < 3; ++t) {
+            w_real[t] = _mm256_loadu_pd(table + 2 * t * m + p);
+            w_imag[t] = _mm256_loadu_pd(table + (2 * t + 1) * m + p);
+        }
+        radix4_butterfly<kInverse>(real, imag, w_real, w_imag);
+
+        // real[t] holds y[4p + t], y[4p + 4 + t], ..., after the transpose, real[j] holds y[4 (p + j) ..][0..3]
+        transpose_lanes(real);
+        transpose_lanes(imag);
+#pragma GCC unroll 4
+        for (uint32_t j = 0; j < 4; ++j) {
+            _mm256_storeu_pd(y + 4 * (p + j), real[j]);
+            _mm256_storeu_pd(y + n + 4 * (p + j), imag[j]);
+        }
+    }
+}
+
+// the other stages (s >= 4), the lanes go along q. the last one writes the interleaved output `y` if `kToComplex`
+template<bool kInverse, bool kToComplex>
+__attribute__((target("avx2,fma"))) void stockham_radix4_stage(const double *x, double *y, uint32_t n, uint32_t m,
+                                                              uint32_t s, const double *table) {
+    const uint32_t quarter = n / 4;
+    __m256d real[4], imag[4], w_real[3], w_imag[3];
+    for (uint32_t p = 0; p < m; ++p) {
+#pragma GCC unroll 4
+        for (uint32_t t = 0; t < 3; ++t) {
+            w_real[t] = _mm256_set1_pd(table[2 * t * quarter + p * s]);
+            w_imag[t] = _mm256_set1_pd(table[(2 * t + 1) * quarter + p * s]);
+        }
+        for (uint32_t q = 0; q < s; q += 4) {
+#pragma GCC unroll 4
+            for (uint32_t r = 0; r < 4; ++r) {
+                real[r] = _mm256_loadu_pd(x + q + s * (p + r * m));
+                imag[r] = _mm256_loadu_pd(x + n + q + s * (p + r * m));
+            }
+            radix4_butterfly<kInverse>(real, imag, w_real, w_imag);
+#pragma GCC unroll 4
+            for (uint32_t t = 0; t < 4; ++t) {
+                if (kToComplex) {
+                    store_complex(y + 2 * (q + s * (4 * p + t)), real[t], imag[t]);
+                } else {
+                    _mm256_storeu_pd(y + q + s * (4 * p + t), real[t]);
+                    _mm256_storeu_pd(y + n + q + s * (4 * p + t), imag[t]);
+                }
+            }
+        }
+    }
+}
+
+// the radix-4 Stockham FFT of length `n` (at least `kStockhamMinLength`) in place, with the twiddles from
+// `FFTRootTable::radix4(n)`. the real and imaginary parts are split into two arrays, so that every lane does the same
+// work, and log_4 n stages go back and forth between two buffers, the last one ends in `a` again. if n is not a
+// power of 4, a radix-2 stage (length 2, with no twiddles) is the last one
+template<bool kInverse>
+__attribute__((target("avx2,fma"))) void stockham_transform(complex<double> *a, uint32_t n, const double *table) {
+    thread_local vector<double> buffer;
+    buffer.resize(4 * static_cast<size_t>(n));
+    double *x = buffer.data(), *y = buffer.data() + 2 * static_cast<size_t>(n);
+    auto *elements = reinterpret_cast<double *>(a);
+
+    stockham_first_stage<kInverse>(elements, x, n, table);
+    uint32_t s = 4;
+    for (uint32_t length = n / 4; length >= 4; length /= 4, s *= 4) {
+        if (length == 4)  // the last stage
+            stockham_radix4_stage<kInverse, true>(x, elements, n, 1, s, table);
+        else
+            stockham_radix4_stage<kInverse, false>(x, y, n, length / 4, s, table);
+        swap(x, y);
+    }
+
+    // length 2 is left: a[q] = x[q] + x[q + s], a[q + s] = x[q] - x[q + s]
+    if (s < n) {
+        for (uint32_t q = 0; q < s; q += 4) {
+            const __m256d l_real = _mm256_loadu_pd(x + q), l_imag = _mm256_loadu_pd(x + n + q);
+            const __m256d r_real = _mm256_loadu_pd(x + q + s), r_imag = _mm256_loadu_pd(x + n + q + s);
+            store_complex(elements + 2 * q, _mm256_add_pd(l_real, r_real), _mm256_add_pd(l_imag, r_imag));
+            store_complex(elements + 2 * (q + s), _mm256_sub_pd(l_real, r_real), _mm256_sub_pd(l_imag, r_imag));
+        }
+    }
+}
+#endif
+
+// transforms longer than this use the four-step algorithm. the radix-2 FFT jumps across the whole array in the last
+// stages, which gets slow when the array (16 bytes per element) falls out of the cache. single-threaded, the four-step
+// FFT wins from 2^21 elements on, but it's also where the threads come in, so it starts a bit earlier.
+// (the radix-4 Stockham FFT makes fewer passes, and single-threaded it's still ahead at 2^21, but it has no threads)
+// note: it must not depend on the number of threads, otherwise the rounding would differ between thread counts
+constexpr uint32_t kFFTFourStepThreshold = 1U << 18;
+
+class FFTContext {
+    std::shared_ptr<const FFTRootTable::Table> roots_;
+    uint32_t stride_;  // e^{2 pi i k / n} is `(*roots_)[k * stride_]`
+    std::shared_ptr<const vector<double>> radix4_;  // `FFTRootTable::radix4(n_)`, only if `stockham_transform` is used
+
+ public:
+    uint32_t n_, k_ = 0;  // n is the maximum size, and n = 1 << k
+
+    // initialize an FFT context with maximum length `m`
+    explicit FFTContext(const uint32_t m) {
+        while ((1U << k_) < m)
+            ++k_;
+        n_ = 1U << k_;
+
+        roots_ = FFTRootTable::get(n_);
+        stride_ = static_cast<uint32_t>(roots_->size() * 2 / n_);
+#if defined(HAS_AVX2_KERNEL)
+        if (n_ >= kStockhamMinLength && n_ <= kFFTFourStepThreshold && cpu_has_avx2_fma())
+            radix4_ = FFTRootTable::radix4(n_);
+#endif
+    }
+
+    // e^{2 pi i k / n}, for 0 <= k < n / 2
+    [[nodiscard]] complex<double> omega(uint32_t k) const {
+        return (*roots_)[k * stride_];
+    }
+
+    // the same context, but with its own contiguous copy of the roots. the short transforms in the four-step FFT
+    // would otherwise read a few roots from every page of the huge shared table, and miss the TLB all the time
+    [[nodiscard]] FFTContext compact() const {
+        FFTContext context = *this;
+        if (stride_ != 1) {
+            auto roots = std::make_shared<FFTRootTable::Table>(n_ >> 1);
+            for (uint32_t k = 0; k < (n_ >> 1); ++k)
+                (*roots)[k] = omega(k);
+            context.roots_ = std::move(roots);
+            context.stride_ = 1;
+        }
+        return context;
+    }
+
+    // e^{2 pi i t / n} (or its conjugate), for 0 <= t < n
+    template<bool kInverse>
+    [[nodiscard]] complex<double> twiddle(uint32_t t) const {
+        complex<double> w = t < (n_ >> 1) ? omega(t) : -omega(t - (n_ >> 1));
+        return kInverse ? conj(w) : w;
+    }
+
+    // four-step FFT, for the transforms that are too large to fit in the cache.
+    // let n = n1 * n2, j = j2 + n2 * j1, and k = k1 + n1 * k2, then
+    //     X[k1 + n1 k2] = sum_{j2} w_{n2}^{j2 k2} * w_n^{j2 k1} * (sum_{j1} x[j2 + n2 j1] * w_{n1}^{j1 k1})
+    // view `a` as an n1 x n2 matrix, it's n2 FFTs of length n1 on the columns, multiplied by the twiddle factors
+    // w_n^{j2 k1}, then n1 FFTs of length n2 on the rows, and the result is transposed.
+    // a few columns (or rows) are copied to a small buffer at a time, so that every short FFT runs in the cache, and
+    // the blocks are independent, so they are distributed to the thread pool.
+    // reference: https://en.wikipedia.org/wiki/Cooley%E2%80%93Tukey_FFT_algorithm#Variations
+    template<bool kInverse>
+    void four_step_transform(complex<double> *a) const {
+        constexpr uint32_t kBlock = 8;  // 8 elements are 128 bytes, two cache lines
+        const uint32_t n1 = 1U << (k_ / 2), n2 = n_ / n1;
+        const FFTContext column_context = FFTContext(n1).compact(), row_context = FFTContext(n2).compact();
+        vector<complex<double>> scratch(n_);
+        ThreadPool &pool = thread_pool();
+
+        // the twiddle factor w_n^t is split to w_n^{t_high * n1} * w_n^{t_low}, both of them are from small tables
+        vector<complex<double>> low(n1), high(n2);
+        for (uint32_t t = 0; t < n1; ++t)
+            low[t] = twiddle<kInverse>(t);
+        for (uint32_t t = 0; t < n2; ++t)
+            high[t] = twiddle<kInverse>(t * n1);
+
+        // 1. FFT on the columns, from `a` to `scratch`
+        pool.parallel_for(n2 / kBlock, [&](size_t block) {
+            thread_local vector<complex<double>> columns;
+            columns.resize(static_cast<size_t>(kBlock) * n1);
+            const uint32_t first = static_cast<uint32_t>(block) * kBlock;
+
+            for (uint32_t j1 = 0; j1 < n1; ++j1)
+                for (uint32_t b = 0; b < kBlock; ++b)
+                    columns[b * n1 + j1] = a[static_cast<size_t>(j1) * n2 + first + b];
+            for (uint32_t b = 0; b < kBlock; ++b) {
+                complex<double> *column = columns.data() + b * n1;
+                column_context.transform<kInverse>(column);
+                for (uint32_t k1 = 1, t = first + b; k1 < n1; ++k1, t += first + b)
+                    column[k1] = complex_multiply(column[k1], complex_multiply(high[t >> (k_ / 2)], low[t & (n1 - 1)]));
+            }
+            for (uint32_t k1 = 0; k1 < n1; ++k1)
+                for (uint32_t b = 0; b < kBlock; ++b)
+                    scratch[static_cast<size_t>(k1) * n2 + first + b] = columns[b * n1 + k1];
+        });
+
+        // 2. FFT on the rows of `scratch`, and write them transposed back to `a`
+        pool.parallel_for(n1 / kBlock, [&](size_t block) {
+            thread_local vector<complex<double>> rows;
+            rows.resize(static_cast<size_t>(kBlock) * n2);
+            const uint32_t first = static_cast<uint32_t>(block) * kBlock;
+
+            copy_n(scratch.begin() + static_cast<ptrdiff_t>(first) * n2, rows.size(), rows.begin());
+            for (uint32_t b = 0; b < kBlock; ++b)
+                row_context.transform<kInverse>(rows.data() + b * n2);
+            for (uint32_t k2 = 0; k2 < n2; ++k2)
+                for (uint32_t b = 0; b < kBlock; ++b)
+                    a[static_cast<size_t>(k2) * n1 + first + b] = rows[b * n2 + k2];
+        });
+    }
+
+    // inverse transform uses the conjugated roots, which is computed on the fly, so no extra table is needed
+    template<bool kInverse>
+    void transform(complex<double> *a) const {
+        if (n_ > kFFTFourStepThreshold)
+            return four_step_transform<kInverse>(a);
+#if defined(HAS_AVX2_KERNEL)
+        if (radix4_ != nullptr && fft_kernel == FFTKernel::kAuto)
+            return stockham_transform<kInverse>(a, n_, radix4_->data());
+#endif
+
+        for (uint32_t i = 0; i < n_; ++i) {
+            // general bits reverse is reverse on 32-bit, but we only want to reverse on k-bit,
+            // so we can right shift (32 - k) bits to make things right
+            uint32_t t = uint32_bit_reverse(i) >> (32 - k_);
+
+            if (i < t)
+                swap(a[i], a[t]);
+        }
+
+        for (uint32_t i = 1; i <= k_; ++i) {
+            uint32_t half = 1U << (i - 1), omega_step = stride_ << (k_ - i);
+            for (auto p = a; p != a + n_; p += 1U << i) {
+                auto l = p, r = p + half;
+                auto omega_iter = roots_->begin();
+                for (uint32_t j = 0; j < half; ++j, ++l, ++r, omega_iter += omega_step) {
+                    complex<double> omega = kInverse ? conj(*omega_iter) : *omega_iter;
+                    complex<double> t = complex_multiply(omega, *r);
+                    *r = *l - t;
+                    *l += t;
+                }
+            }
+        }
+    }
+
+    // transform the first `n_` elements of `a`
+    void dft(complex<double> *a) const {
+        transform<false>(a);
+    }
+
+    void inverse_dft(complex<double> *a) const {
+        transform<true>(a);
+        for (auto p = a; p != a + n_; ++p)
+            *p /= n_;
+    }
+
+    void dft(vector<complex<double>> &a) const {
+        assert(a.size() == n_);
+        dft(a.data());
+    }
+
+    void inverse_dft(vector<complex<double>> &a) const {
+        assert(a.size() == n_);
+        inverse_dft(a.data());
+    }
+};
+
+// the DFT of a real sequence x of length n = 2m can be calculated by a complex DFT of length m:
+// let z[j] = x[2j] + i x[2j+1], and Z = DFT(z), then the DFT of the even and odd part of x are
+//     E[k] = (Z[k] + conj(Z[m-k])) / 2,    O[k] = (Z[k] - conj(Z[m-k])) / 2i
+// and X[k] = E[k] + w^k O[k], where w = e^{2 pi i / n}. since X[n-k] = conj(X[k]), only X[0..m] are needed
+//
+// `full` is the context of length n, and `half` is the context of length m.
+// before: a[j] = x[2j] + i x[2j+1] for 0 <= j < m, after: a[k] = X[k] for 0 <= k <= m
+void real_dft(const FFTContext &full, const FFTContext &half, complex<double> *a) {
+    const uint32_t m = half.n_;
+    half.dft(a);
+    a[m] = a[0];  // Z is periodic, Z[m] = Z[0]
+
+    // X[k] and X[m-k] depend on the same two elements of Z, so calculate them in pairs
+    for (uint32_t k = 0; k <= m / 2; ++k) {
+        uint32_t j = m - k;
+        complex<double> zk = a[k], zj = a[j];
+        complex<double> ek = (zk + conj(zj)) * 0.5, ok = (zk - conj(zj)) * complex<double>(0, -0.5);
+        complex<double> ej = (zj + conj(zk)) * 0.5, oj = (zj - conj(zk)) * complex<double>(0, -0.5);
+        a[k] = ek + full.omega(k) * ok;
+        a[j] = j == m ? ej - oj : ej + full.omega(j) * oj;  // w^m = -1
+    }
+}
+
+// the inverse of `real_dft`: given X[0..m] (the DFT of a real sequence x), recover x by an inverse DFT of length m.
+// it's just the reverse of the steps above:
+//     E[k] = (X[k] + conj(X[m-k])) / 2,    O[k] = (X[k] - conj(X[m-k])) / 2 * conj(w^k)
+// then z = IDFT(E + i O), and z[j] = x[2j] + i x[2j+1]
+//
+// before: a[k] = X[k] for 0 <= k <= m, after: a[j] = x[2j] + i x[2j+1] for 0 <= j < m
+void inverse_real_dft(const FFTContext &full, const FFTContext &half, complex<double> *a) {
+    const uint32_t m = half.n_;
+
+    for (uint32_t k = 0; k <= m / 2; ++k) {
+        uint32_t j = m - k;
+        complex<double> xk = a[k], xj = a[j];
+        complex<double> ek = (xk + conj(xj)) * 0.5, ok = (xk - conj(xj)) * 0.5 * conj(full.omega(k));
+        a[k] = ek + complex<double>(0, 1) * ok;
+        if (j < m) {
+            complex<double> ej = (xj + conj(xk)) * 0.5, oj = (xj - conj(xk)) * 0.5 * conj(full.omega(j));
+            a[j] = ej + complex<double>(0, 1) * oj;
+        }
+    }
+
+    half.inverse_dft(a);
+}
+
+// calculate `base^exponent mod modulus` by fast exponentiation
+constexpr uint32_t pow_mod(uint64_t base, uint64_t exponent, uint32_t modulus) {
+    uint64_t result = 1;
+    base %= modulus;
+    for (; exponent > 0; exponent >>= 1) {
+        if (exponent & 1)
+            result = result * base % modulus;
+        base = base * base % modulus;
+    }
+    return static_cast<uint32_t>(result);
+}
+
+// number-theoretic transform over Z/pZ, where p = `kModulus` is a prime of the form c * 2^k + 1, and `kPrimitiveRoot`
+// is one of its primitive roots. unlike FFT, everything is an integer here, so the result is always exact
+template<uint32_t kModulus, uint32_t kPrimitiveRoot>
+class NTTContext {
+    static_assert(kModulus < (1U << 31), "additions of two residues must not overflow `uint32_t`");
+
+    vector<uint32_t> omega_, omega_inverse_;
+    uint32_t n_inverse_;
+
+ public:
+    uint32_t n_, k_ = 0;  // n is the maximum size, and n = 1 << k
+
+    static uint32_t mul(uint32_t lhs, uint32_t rhs) {
+        return static_cast<uint32_t>(static_cast<uint64_t>(lhs) * rhs % kModulus);
+    }
+
+    static uint32_t add(uint32_t lhs, uint32_t rhs) {
+        return lhs + rhs >= kModulus ? lhs + rhs - kModulus : lhs + rhs;
+    }
+
+    static uint32_t pow(uint32_t base, uint64_t exponent) {
+        return pow_mod(base, exponent, kModulus);
+    }
+
+    static uint32_t inverse(uint32_t x) {
+        return pow(x, kModulus - 2);
+    }
+
+    // the n-th root of unity, which plays the same role as "e^{2 pi i / n}" in FFT. n must divide `kModulus - 1`
+    static uint32_t root_of_unity(uint32_t n) {
+        return pow(kPrimitiveRoot, (kModulus - 1) / n);
+    }
+
+    // initialize an NTT context with maximum length `m`
+    explicit NTTContext(const uint32_t m) {
+        while ((1U << k_) < m)
+            ++k_;
+        n_ = 1U << k_;
+        assert((kModulus - 1) % n_ == 0);  // assert that the n-th root of unity exists
+
+        uint32_t root = root_of_unity(n_), root_inverse = inverse(root);
+        n_inverse_ = inverse(n_);
+
+        omega_.reserve(n_ >> 1);
+        omega_inverse_.reserve(n_ >> 1);
+        for (uint32_t i = 0, w = 1, w_inverse = 1; i < (n_ >> 1); ++i) {
+            omega_.push_back(w);
+            omega_inverse_.push_back(w_inverse);
+            w = mul(w, root);
+            w_inverse = mul(w_inverse, root_inverse);
+        }
+    }
+
+    // exactly the same as `FFTContext::transform`, but the butterflies are performed in modular arithmetic
+    void transform(uint32_t *a, const vector<uint32_t> &omega) const {
+        // a transform of one point is the identity, and the bit reversal below would shift by 32
+        if (k_ == 0)
+            return;
+
+        for (uint32_t i = 0; i < n_; ++i) {
+            uint32_t t = uint32_bit_reverse(i) >> (32 - k_);
+            if (i < t)
+                swap(a[i], a[t]);
+        }
+
+        for (uint32_t i = 1; i <= k_; ++i) {
+            uint32_t omega_step = 1U << (k_ - i);
+            for (auto p = a; p != a + n_; p += 1U << i) {
+                auto l = p, r = p + (1U << (i - 1));
+                for (auto omega_iter = omega.begin(); omega_iter != omega.end(); ++l, ++r, omega_iter += omega_step) {
+                    uint32_t t = mul(*omega_iter, *r);
+                    *r = *l >= t ? *l - t : *l + kModulus - t;
+                    *l = *l + t >= kModulus ? *l + t - kModulus : *l + t;
+                }
+            }
+        }
+    }
+
+    // transform the first `n_` elements of `a`
+    void dft(uint32_t *a) const {
+        transform(a, omega_);
+    }
+
+    void inverse_dft(uint32_t *a) const {
+        transform(a, omega_inverse_);
+        for (auto p = a; p != a + n_; ++p)
+            *p = mul(*p, n_inverse_);
+    }
+
+    void dft(vector<uint32_t> &a) const {
+        assert(a.size() == n_);
+        dft(a.data());
+    }
+
+    void inverse_dft(vector<uint32_t> &a) const {
+        assert(a.size() == n_);
+        inverse_dft(a.data());
+    }
+
+    // multiply two polynomials modulo `kModulus`, the result is stored in `lhs`
+    void convolve(vector<uint32_t> &lhs, vector<uint32_t> &rhs) const {
+        dft(lhs);
+        dft(rhs);
+        ::transform(lhs.begin(), lhs.end(), rhs.begin(), lhs.begin(), mul);
+        inverse_dft(lhs);
+    }
+};
+
+// the three NTT-friendly primes, all of them support transforms of length up to 2^24.
+// their product is about 5.9 * 10^25, so the convolution is exact as long as every coefficient of the result is smaller
+// than that. with base 10^8 points, it is n * (10^8)^2 <= 2^24 * 10^16 ~ 1.7 * 10^23, which is far enough, and even
+// base 10^9 limbs (see `Limb32`) give at most 2^24 * 10^18 ~ 1.7 * 10^25.
+constexpr uint32_t kNTTModulus1 = 754974721;  // 45 * 2^24 + 1
+constexpr uint32_t kNTTModulus2 = 167772161;  //  5 * 2^25 + 1
+constexpr uint32_t kNTTModulus3 = 469762049;  //  7 * 2^26 + 1
+constexpr uint32_t kNTTMaxLength = 1U << 24;
+
+using NTTContext1 = NTTContext<kNTTModulus1, 11>;
+using NTTContext2 = NTTContext<kNTTModulus2, 3>;
+using NTTContext3 = NTTContext<kNTTModulus3, 3>;
+
+// recover x (mod m1 * m2 * m3) from its residues (x mod m1, x mod m2, x mod m3) by Garner's algorithm:
+//     x = x12 + m1 * m2 * t3, where x12 = x mod (m1 * m2) = r1 + m1 * t2, t2 < m2, t3 < m3
+// then add x to `carry`, and return the lowest "digit" of base `range` (and `carry` keeps the rest).
+//
+// x may be up to 2^86, but we can keep everything in `uint64_t` by splitting m1 * m2 = q * range + r, so that
+//     carry + x = (carry + x12 + r * t3) + q * t3 * range
+// for `range` <= 10^9, none of the terms above exceeds 2^64
+inline uint32_t chinese_remainder_carry(uint32_t r1, uint32_t r2, uint32_t r3, uint64_t range, uint64_t &carry) {
+    constexpr uint64_t kM1M2 = static_cast<uint64_t>(kNTTModulus1) * kNTTModulus2;
+    constexpr uint64_t kM1InverseMod2 = pow_mod(kNTTModulus1, kNTTModulus2 - 2, kNTTModulus2);
+    constexpr uint64_t kM1M2InverseMod3 = pow_mod(kM1M2, kNTTModulus3 - 2, kNTTModulus3);
+
+    uint64_t t2 = (r2 + kNTTModulus2 - r1 % kNTTModulus2) * kM1InverseMod2 % kNTTModulus2;
+    uint64_t x12 = r1 + kNTTModulus1 * t2;
+    uint64_t t3 = (r3 + kNTTModulus3 - x12 % kNTTModulus3) * kM1M2InverseMod3 % kNTTModulus3;
+
+    uint64_t low = carry + x12 + kM1M2 % range * t3;
+    carry = low / range + kM1M2 / range * t3;
+    return static_cast<uint32_t>(low % range);
+}
+
+// one element of `BigInteger::digits_` holds `kDigitWidth` decimal digits, that is, it's in base `kDigitRange`
+constexpr int kDigitWidth = 4;
+constexpr int kDigitRange = 10000;
+constexpr uint32_t kNTTPointRange = kDigitRange * kDigitRange;  // NTT packs two elements into one point
+
+// the multiplication is tiered by the length (in elements) of the shorter operand:
+//   [1, kKaratsubaThreshold)                  schoolbook,  O(n^2),   but no overhead at all
+//   [kKaratsubaThreshold, kToom3Threshold)    Karatsuba,   O(n^1.58)
+//   [kToom3Threshold, kTransformThreshold)    Toom-3,      O(n^1.46)
+//   [kTransformThreshold, +inf)               FFT or NTT,  O(n log n), but with a large constant
+// the thresholds are the crossovers measured by `BM_MultiplyAlgorithm` in mul_benchmark (Release build, -O2)
+constexpr size_t kKaratsubaThreshold = 32;
+constexpr size_t kToom3Threshold = 96;
+constexpr size_t kTransformThreshold = 256;
+
+// with `LimbPolicy::kWide`, schoolbook on base 10^9 limbs replaces Karatsuba and Toom-3 from this length up to
+// `kTransformThreshold`, balanced or not. below it, packing the limbs costs more than the products it saves.
+// measured by `BM_LimbPolicyMultiply` in mul_benchmark
+constexpr size_t kWideSchoolbookThreshold = 16;
+
+// in `MultiplyEngine::kAuto`, switch to NTT when the result is longer than this number of elements.
+// with adversarial operands (like "9999...9999"), the FFT rounding error is measured to be 0.06 at 2^20 elements,
+// and 0.28 at 2^22 elements, which is too close to 0.5, where `round` starts to give wrong carries
+constexpr size_t kNTTThreshold = 1U << 20;
+
+// `BigInteger::multiply_into` cuts the longer operand into blocks (see `multiply_by_chunked_fft`) if it's at least
+// this times longer than the shorter one, measured by `BM_BigIntegerUnbalanced` in mul_benchmark
+constexpr size_t kUnbalancedRatio = 8;
+
+// every FFT product is checked while it's carried: if a coefficient is farther than this from its nearest integer,
+// the rounding may have picked a wrong one, and the product is redone by NTT. the largest distance observed is only a
+// lower bound of the largest error, so the bound keeps a margin below 0.5
+double fft_error_bound = 0.25;
+
+// the bytes the transforms of one NTT product may take. a product whose transforms would be larger (or longer than
+// `kNTTMaxLength`) is multiplied by `multiply_by_out_of_core_ntt`, which keeps them in temporary files instead
+size_t transform_memory_limit = std::numeric_limits<size_t>::max();
+
+// `BigDecimal::multiply_significant` keeps this number of extra elements beyond the requested digits, so that the
+// error of the short product almost never reaches the requested digits
+constexpr size_t kShortProductGuard = 3;
+
+// multiply polynomials `a` (with `n` coefficients) and `b` (with `m` coefficients) by definition,
+// and write the `n + m - 1` coefficients of the product to `out`
+void schoolbook_multiply(const int64_t *a, size_t n, const int64_t *b, size_t m, int64_t *out) {
+    fill_n(out, n + m - 1, 0);
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = 0; j < m; ++j)
+            out[i + j] += a[i] * b[j];
+}
+
+// the recursive multiplications below take their temporaries from `work` instead of the heap: every level uses the
+// front of it, and passes the rest to the sub-products, which run one after another. these functions give the number
+// of coefficients `work` must have
+
+// for `balanced_multiply` of length `n`
+size_t balanced_workspace(size_t n) {
+    if (n < kKaratsubaThreshold)
+        return 0;
+    if (n < kToom3Threshold) {
+        size_t l = n - n / 2;
+        return 4 * l + balanced_workspace(l);
+    }
+    size_t k = (n + 2) / 3;
+    return 6 * k + 5 * (2 * k - 1) + balanced_workspace(k);
+}
+
+// for `polynomial_multiply` of lengths `n` and `m`
+size_t polynomial_workspace(size_t n, size_t m) {
+    if (n < m)
+        swap(n, m);
+    if (m < kKaratsubaThreshold)
+        return 0;
+    size_t rest = n % m == 0 ? 0 : polynomial_workspace(m, n % m);
+    return 2 * m - 1 + max(balanced_workspace(m), rest);
+}
+
+// for `short_multiply` of length `n`
+size_t short_workspace(size_t n) {
+    if (n < kKaratsubaThreshold)
+        return 0;
+    const size_t k = (7 * n + 9) / 10, l = n - k;
+    return 2 * k - 1 + l + max(balanced_workspace(k), short_workspace(l));
+}
+
+void balanced_multiply(const int64_t *a, const int64_t *b, size_t n, int64_t *out, int64_t *work);
+
+// Karatsuba: for a = a0 + a1 x^h and b = b0 + b1 x^h, we have
+//     a * b = a0 b0 + ((a0 + a1)(b0 + b1) - a0 b0 - a1 b1) x^h + a1 b1 x^2h
+// so only 3 multiplications of half length are needed, instead of 4
+void karatsuba_multiply(const int64_t *a, const int64_t *b, size_t n, int64_t *out, int64_t *work) {
+    assert(n >= 2);
+    size_t h = n / 2, l = n - h;  // the low part has `h` coefficients, and the high part has `l` (>= h) coefficients
+
+    int64_t *sum_a = work, *sum_b = sum_a + l, *middle = sum_b + l;
+    work = middle + 2 * l;
+    copy(a + h, a + n, sum_a);
+    copy(b + h, b + n, sum_b);
+    for (size_t i = 0; i < h; ++i) {
+        sum_a[i] += a[i];
+        sum_b[i] += b[i];
+    }
+    balanced_multiply(sum_a, sum_b, l, middle, work);
+
+    // a0 b0 and a1 b1 don't overlap, so we can put them directly to `out`
+    balanced_multiply(a, b, h, out, work);
+    out[2 * h - 1] = 0;
+    balanced_multiply(a + h, b + h, l, out + 2 * h, work);
+
+    for (size_t i = 0; i < 2 * h - 1; ++i)
+        middle[i] -= out[i];
+    for (size_t i = 0; i < 2 * l - 1; ++i)
+        middle[i] -= out[2 * h + i];
+    for (size_t i = 0; i < 2 * l - 1; ++i)
+        out[h + i] += middle[i];
+}
+
+// Toom-3: split a = a0 + a1 x^k + a2 x^2k (so does b), then a * b is a polynomial of degree 4 in x^k, which is
+// determined by its values at 5 points. we evaluate at 0, 1, -1, -2 and infinity, so only 5 multiplications of
+// one-third length are needed, then interpolate by Bodrato's sequence
+// reference: https://en.wikipedia.org/wiki/Toom%E2%80%93Cook_multiplication#Interpolation
+void toom3_multiply(const int64_t *a, const int64_t *b, size_t n, int64_t *out, int64_t *work) {
+    assert(n >= 5);
+    size_t k = (n + 2) / 3, top = n - 2 * k;  // a2 and b2 have `top` (1 <= top <= k) coefficients
+    size_t length = 2 * k - 1;
+
+    const auto evaluate = [k, top](const int64_t *p, int64_t *at_1, int64_t *at_minus_1, int64_t *at_minus_2) {
+        for (size_t i = 0; i < k; ++i) {
+            int64_t p0 = p[i], p1 = p[k + i], p2 = i < top ? p[2 * k + i] : 0;
+            at_1[i] = p0 + p1 + p2;
+            at_minus_1[i] = p0 - p1 + p2;
+            at_minus_2[i] = p0 - 2 * p1 + 4 * p2;
+        }
+    };
+    int64_t *a_1 = work, *a_minus_1 = a_1 + k, *a_minus_2 = a_minus_1 + k;
+    int64_t *b_1 = a_minus_2 + k, *b_minus_1 = b_1 + k, *b_minus_2 = b_minus_1 + k;
+    evaluate(a, a_1, a_minus_1, a_minus_2);
+    evaluate(b, b_1, b_minus_1, b_minus_2);
+
+    int64_t *r0 = b_minus_2 + k, *r1 = r0 + length, *r2 = r1 + length, *r3 = r2 + length, *r4 = r3 + length;
+    work = r4 + length;
+    fill_n(r4, length, 0);
+    balanced_multiply(a, b, k, r0, work);                           // r(0)
+    balanced_multiply(a_1, b_1, k, r1, work);                       // r(1)
+    balanced_multiply(a_minus_1, b_minus_1, k, r2, work);           // r(-1)
+    balanced_multiply(a_minus_2, b_minus_2, k, r3, work);           // r(-2)
+    balanced_multiply(a + 2 * k, b + 2 * k, top, r4, work);         // r(inf)
+
+    // all the divisions below are exact, since r(x) is a polynomial with integer coefficients
+    for (size_t i = 0; i < length; ++i) {
+        int64_t v3 = (r3[i] - r1[i]) / 3;
+        int64_t v1 = (r1[i] - r2[i]) / 2;
+        int64_t v2 = r2[i] - r0[i];
+        v3 = (v2 - v3) / 2 + 2 * r4[i];
+        v2 = v2 + v1 - r4[i];
+        v1 = v1 - v3;
+        r1[i] = v1;
+        r2[i] = v2;
+        r3[i] = v3;
+    }
+
+    // recomposition, the coefficients beyond `2n - 1` must be zero, so we just skip them
+    fill_n(out, 2 * n - 1, 0);
+    size_t shift = 0;
+    for (const int64_t *r : {r0, r1, r2, r3, r4}) {
+        for (size_t i = 0; i < length && shift + i < 2 * n - 1; ++i)
+            out[shift + i] += r[i];
+        shift += k;
+    }
+}
+
+// multiply two polynomials with the same length `n`, and choose the algorithm by `n`
+void balanced_multiply(const int64_t *a, const int64_t *b, size_t n, int64_t *out, int64_t *work) {
+    if (n < kKaratsubaThreshold)
+        schoolbook_multiply(a, n, b, n, out);
+    else if (n < kToom3Threshold)
+        karatsuba_multiply(a, b, n, out, work);
+    else
+        toom3_multiply(a, b, n, out, work);
+}
+
+// multiply two polynomials with arbitrary lengths. if they are unbalanced, we cut the longer one into blocks with the
+// length of the shorter one, so that every block multiplication is balanced
+void polynomial_multiply(const int64_t *a, size_t n, const int64_t *b, size_t m, int64_t *out, int64_t *work) {
+    if (n < m)
+        return polynomial_multiply(b, m, a, n, out, work);
+    if (m < kKaratsubaThreshold)
+        return schoolbook_multiply(a, n, b, m, out);
+
+    fill_n(out, n + m - 1, 0);
+    int64_t *block = work;
+    work = block + 2 * m - 1;
+    for (size_t offset = 0; offset < n; offset += m) {
+        size_t length = min(m, n - offset);
+        if (length == m)
+            balanced_multiply(a + offset, b, m, block, work);
+        else
+            polynomial_multiply(b, m, a + offset, length, block, work);
+
+        for (size_t i = 0; i < length + m - 1; ++i)
+            out[offset + i] += block[i];
+    }
+}
+
+// short product: only the high half of the product, that is, the terms a[i] b[j] with i + j >= n - 1 (`a` and `b` both
+// have `n` coefficients), and write the columns [n - 1, 2n - 1) of the product to `out[0, n)`
+//
+// Mulders' algorithm: let l = n - k (k >= l), the terms with i, j >= l are the full product of the top k coefficients,
+// and the rest are the terms of a[0, l) * b[k, n) and a[k, n) * b[0, l), which turn out to be two short products of
+// length l, whose columns are exactly at the same place in `out`. with k ~ 0.7n, it's about 80% of a full product.
+// reference: T. Mulders, On Short Multiplications and Divisions, AAECC 11 (2000)
+void short_multiply(const int64_t *a, const int64_t *b, size_t n, int64_t *out, int64_t *work) {
+    if (n < kKaratsubaThreshold) {
+        fill_n(out, n, 0);
+        for (size_t i = 0; i < n; ++i)
+            for (size_t j = n - 1 - i; j < n; ++j)
+                out[i + j - (n - 1)] += a[i] * b[j];
+        return;
+    }
+
+    const size_t k = (7 * n + 9) / 10, l = n - k;
+    int64_t *full = work, *part = full + 2 * k - 1;
+    work = part + l;
+    balanced_multiply(a + l, b + l, k, full, work);
+
+    // the column i + j + 2l of the full product is at `out[i + j + 2l - (n - 1)]`, only those >= 0 are needed
+    fill_n(out, n, 0);
+    for (size_t t = k - l - 1; t < 2 * k - 1; ++t)
+        out[t + l + 1 - k] = full[t];
+
+    short_multiply(a, b + k, l, part, work);
+    for (size_t t = 0; t < l; ++t)
+        out[t] += part[t];
+    short_multiply(a + k, b, l, part, work);
+    for (size_t t = 0; t < l; ++t)
+        out[t] += part[t];
+}
+
+// the memory `BigInteger::multiply_into` works in: every buffer grows to the longest multiplication it has seen, and
+// is never shrunk, so a scratch reused for operands of similar lengths makes no heap allocation in steady state
+// (except the four-step FFT above `kFFTFourStepThreshold`, whose own buffers cost nothing next to its work).
+// a scratch can be used by only one multiplication at a time, i.e. one scratch per thread
+class MultiplyScratch {
+ public:
+    vector<int64_t> coefficients_;            // the operands, the product and `work` of the polynomial multiplication
+    vector<complex<double>> points_;          // FFT points
+    vector<complex<double>> spectrum_;        // the transformed short operand of `multiply_by_chunked_fft`
+    std::array<vector<uint32_t>, 6> residues_;  // NTT points, the two operands modulo each of the three primes
+    std::unique_ptr<NTTContext1> ntt1_;       // the contexts of the last NTT, kept if the next one has the same length
+    std::unique_ptr<NTTContext2> ntt2_;
+    std::unique_ptr<NTTContext3> ntt3_;
+    std::array<vector<uint32_t>, 3> limbs_;   // the operands and the product of `multiply_by_wide_schoolbook`
+    vector<uint16_t> product_;                // the product when the result is one of the operands
+
+    // the memory held by the buffers above
+    [[nodiscard]] size_t bytes() const {
+        size_t bytes = coefficients_.capacity() * sizeof(int64_t) + product_.capacity() * sizeof(uint16_t) +
+                       (points_.capacity() + spectrum_.capacity()) * sizeof(complex<double>);
+        for (const auto &residues : residues_)
+            bytes += residues.capacity() * sizeof(uint32_t);
+        for (const auto &limbs : limbs_)
+            bytes += limbs.capacity() * sizeof(uint32_t);
+        for (uint32_t n : {ntt1_ ? ntt1_->n_ : 0, ntt2_ ? ntt2_->n_ : 0, ntt3_ ? ntt3_->n_ : 0})
+            bytes += n * sizeof(uint32_t);  // n / 2 roots and n / 2 inverse roots
+        return bytes;
+    }
+};
+
+// the following functions multiply two numbers in base `kDigitRange` (from the least significant element),
+// and append the elements of the product to `result`, with possible leading zeros
+
+// product scanning: calculate the product from the least significant element, and carry immediately,
+// so that it needs no extra memory, which makes it the fastest for short operands
+void multiply_by_schoolbook(const vector<uint16_t> &lhs, const vector<uint16_t> &rhs, vector<uint16_t> &result) {
+    PhaseTimer timer(Phase::kDirectProduct);  // the carries are interleaved with the products
+    size_t n = lhs.size(), m = rhs.size();
+    result.reserve(result.size() + n + m);
+
+    uint64_t carry = 0;
+    for (size_t k = 0; k + 1 < n + m; ++k) {
+        uint64_t sum = carry;
+        for (size_t i = k < m ? 0 : k - m + 1; i < n && i <= k; ++i)
+            sum += static_cast<uint64_t>(lhs[i]) * rhs[k - i];
+        result.push_back(static_cast<uint16_t>(sum % kDigitRange));
+        carry = sum / kDigitRange;
+    }
+    result.push_back(static_cast<uint16_t>(carry));
+}
+
+// carry the coefficients [first, last) of a polynomial product, and append them to `result`
+void collect_polynomial_result(const int64_t *first, const int64_t *last, vector<uint16_t> &result) {
+    PhaseTimer timer(Phase::kCarry);
+    result.reserve(result.size() + static_cast<size_t>(last - first) + 1);
+    int64_t carry = 0;
+    for (const int64_t *p = first; p != last; ++p) {
+        carry += *p;
+        result.push_back(static_cast<uint16_t>(carry % kDigitRange));
+        carry /= kDigitRange;
+    }
+    result.push_back(static_cast<uint16_t>(carry));
+}
+
+// multiply by Karatsuba / Toom-3 on the elements, and carry at the end
+void multiply_by_polynomial(const vector<uint16_t> &lhs, const vector<uint16_t> &rhs, vector<uint16_t> &result,
+                            MultiplyScratch &scratch) {
+    PhaseTimer timer(Phase::kDirectProduct);
+    const size_t n = lhs.size(), m = rhs.size();
+    scratch.coefficients_.resize(n + m + (n + m - 1) + polynomial_workspace(n, m));
+    int64_t *a = scratch.coefficients_.data(), *b = a + n, *product = b + m;
+    copy(lhs.begin(), lhs.end(), a);
+    copy(rhs.begin(), rhs.end(), b);
+    polynomial_multiply(a, n, b, m, product, product + n + m - 1);
+    timer.stop();
+
+    collect_polynomial_result(product, product + n + m - 1, result);
+}
+
+// an approximation of the high part of the product: the top `k` elements of both operands (padded by zeros at the
+// bottom if shorter) are multiplied by the short product, and the columns from `k - 1` of it are carried to `result`,
+// so the cost only depends on `k`. see `BigDecimal::multiply_significant` for the error bound
+void multiply_by_short_product(const vector<uint16_t> &lhs, const vector<uint16_t> &rhs, size_t k,
+                               vector<uint16_t> &result, MultiplyScratch &scratch) {
+    PhaseTimer timer(Phase::kDirectProduct);
+    scratch.coefficients_.assign(3 * k + short_workspace(k), 0);
+    int64_t *a = scratch.coefficients_.data(), *b = a + k, *product = b + k;
+    const size_t n = min(k, lhs.size()), m = min(k, rhs.size());
+    copy(lhs.data() + lhs.size() - n, lhs.data() + lhs.size(), a + k - n);
+    copy(rhs.data() + rhs.size() - m, rhs.data() + rhs.size(), b + k - m);
+    short_multiply(a, b, k, product, product + k);
+    timer.stop();
+
+    collect_polynomial_result(product, product + k, result);
+}
+
+// collect results from the polynomial, or you can just think that substituting x = 10000 into the polynomial to
+// calculate the value. `a[j]` holds the coefficients of x^2j (real part) and x^(2j+1) (imaginary part).
+// returns the largest distance from a coefficient to its nearest integer
+double collect_fft_result(const complex<double> *a, uint32_t m, vector<uint16_t> &result) {
+    PhaseTimer timer(Phase::kCarry);
+    result.reserve(result.size() + 2 * m);
+    int64_t carry = 0;
+    double error = 0;
+    for (const auto *p = a; p != a + m; ++p) {
+        for (double coefficient : {p->real(), p->imag()}) {
+            double rounded = round(coefficient);
+            error = max(error, std::abs(coefficient - rounded));
+            carry += static_cast<decltype(carry)>(rounded);
+            result.push_back(static_cast<uint16_t>(carry % kDigitRange));
+            carry /= kDigitRange;
+        }
+    }
+
+    if (kStatsCompiled && stats_enabled)
+        multiply_stats.add_rounding_error(error);
+    return error;
+}
+
+// squaring needs only one real DFT of the operand, that is, a complex DFT of half length
+double square_by_fft(const vector<uint16_t> &digits, vector<uint16_t> &result, MultiplyScratch &scratch) {
+    PhaseTimer transform_timer(Phase::kTransform);
+    FFTContext full(max<size_t>(digits.size() * 2, 4)), half(full.n_ / 2);
+    const uint32_t m = half.n_;
+    if (kStatsCompiled && stats_enabled)
+        multiply_stats.add_transform(m);
+
+    // fold the digits into a complex sequence, a[j] = digits[2j] + i digits[2j+1]
+    vector<complex<double>> &a = scratch.points_;
+    a.assign(m + 1, 0);
+    for (size_t i = 0; i < digits.size(); ++i)
+        reinterpret_cast<double *>(a.data())[i] = digits[i];
+
+    real_dft(full, half, a.data());
+    transform_timer.stop();
+
+    PhaseTimer pointwise_timer(Phase::kPointwise);
+    for (auto &p : a)
+        p *= p;
+    pointwise_timer.stop();
+
+    PhaseTimer inverse_timer(Phase::kInverseTransform);
+    inverse_real_dft(full, half, a.data());
+    inverse_timer.stop();
+
+    return collect_fft_result(a.data(), m, result);
+}
+
+// multiply via FFT:
+// first we transform the polynomial from coefficient representation to point-value representation by DFT,
+// then we perform multiplication on the point values, and transform the product back by I-DFT.
+//
+// since both operands are real, we put `lhs` in the real part and `rhs` in the imaginary part, so one complex DFT
+// transforms both of them. then split the spectra by symmetry (let Z = DFT(lhs + i rhs)):
+//     LHS[k] = (Z[k] + conj(Z[n-k])) / 2,    RHS[k] = (Z[k] - conj(Z[n-k])) / 2i
+// the product is real too, so the inverse DFT only needs half length (see `inverse_real_dft`)
+//
+// returns the rounding error of the product (see `collect_fft_result`), it's wrong if the error is too large
+double multiply_by_fft(const vector<uint16_t> &lhs, const vector<uint16_t> &rhs, vector<uint16_t> &result,
+                       MultiplyScratch &scratch) {
+    if (&lhs == &rhs || lhs == rhs)
+        return square_by_fft(lhs, result, scratch);
+
+    // prepare FFT context:
+    // for two numbers with length `x` and `y`, the length of the multiplication result will be at most `x + y`
+    PhaseTimer transform_timer(Phase::kTransform);
+    FFTContext full(max<size_t>(lhs.size() + rhs.size(), 4)), half(full.n_ / 2);
+    const uint32_t n = full.n_, m = half.n_;
+    if (kStatsCompiled && stats_enabled)
+        multiply_stats.add_transform(n);
+
+    vector<complex<double>> &a = scratch.points_;
+    a.assign(n, 0);
+    for (size_t i = 0; i < lhs.size(); ++i)
+        a[i].real(lhs[i]);
+    for (size_t i = 0; i < rhs.size(); ++i)
+        a[i].imag(rhs[i]);
+
+    full.dft(a);
+    transform_timer.stop();
+
+    // split the spectra and multiply them, only the first m + 1 are needed. it can be done in-place, since a[n-k] is
+    // never overwritten for k < m
+    PhaseTimer pointwise_timer(Phase::kPointwise);
+    for (uint32_t k = 0; k <= m; ++k) {
+        complex<double> zk = a[k], zj = conj(a[(n - k) & (n - 1)]);
+        a[k] = (zk + zj) * (zk - zj) * complex<double>(0, -0.25);
+    }
+    pointwise_timer.stop();
+
+    PhaseTimer inverse_timer(Phase::kInverseTransform);
+    inverse_real_dft(full, half, a.data());
+    inverse_timer.stop();
+
+    return collect_fft_result(a.data(), m, result);
+}
+
+// multiply a long operand by a much shorter one (see `kUnbalancedRatio`). padding both to the length of the product
+// would transform a mostly empty array, so the long one is cut into blocks instead, and every block is multiplied by
+// the short one with a transform of about twice the short length, so the time is linear in the long length.
+//
+// the short operand is transformed only once, and two blocks share a transform: since DFT(s) is the spectrum of a real
+// sequence, IDFT(DFT(x + i y) * DFT(s)) = x * s + i (y * s), so the products of both blocks are the real and the
+// imaginary parts. the block products overlap by `short - 1` coefficients, which are kept in `coefficients_` and added
+// to the next ones, the others are final, and carried right away.
+//
+// returns the rounding error, like `multiply_by_fft`
+double multiply_by_chunked_fft(const vector<uint16_t> &lhs, const vector<uint16_t> &rhs, vector<uint16_t> &result,
+                               MultiplyScratch &scratch) {
+    const vector<uint16_t> &longer = lhs.size() >= rhs.size() ? lhs : rhs, &shorter = &longer == &lhs ? rhs : lhs;
+    const FFTContext context(max<size_t>(2 * shorter.size(), 4));
+    const uint32_t n = context.n_;
+    const size_t block = n - shorter.size() + 1;  // a block times the short operand has exactly n coefficients
+    if (kStatsCompiled && stats_enabled)
+        multiply_stats.add_transform(n);
+
+    PhaseTimer transform_timer(Phase::kTransform);
+    vector<complex<double>> &spectrum = scratch.spectrum_, &a = scratch.points_;
+    spectrum.assign(n, 0);
+    copy(shorter.begin(), shorter.end(), spectrum.begin());
+    context.dft(spectrum);
+    transform_timer.stop();
+
+    // the coefficients from `offset` of the product, summed over the blocks so far
+    vector<int64_t> &window = scratch.coefficients_;
+    window.assign(n, 0);
+    result.reserve(result.size() + longer.size() + shorter.size() + 1);
+    int64_t carry = 0;
+    double error = 0;
+
+    // add the product of a block (the real or the imaginary parts of `a`) to `window`, carry the first `count`
+    // coefficients, which no later block reaches, and shift the rest to the front
+    const auto accumulate = [&](size_t part, size_t count) {
+        PhaseTimer carry_timer(Phase::kCarry);
+        const double *coefficients = reinterpret_cast<const double *>(a.data()) + part;
+        for (uint32_t i = 0; i < n; ++i) {
+            double rounded = round(coefficients[2 * i]);
+            error = max(error, std::abs(coefficients[2 * i] - rounded));
+            window[i] += static_cast<int64_t>(rounded);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            carry += window[i];
+            result.push_back(static_cast<uint16_t>(carry % kDigitRange));
+            carry /= kDigitRange;
+        }
+        copy(window.begin() + static_cast<ptrdiff_t>(count), window.end(), window.begin());
+        fill_n(window.end() - static_cast<ptrdiff_t>(count), count, 0);
+    };
+
+    for (size_t offset = 0; offset < longer.size(); offset += 2 * block) {
+        // blocks [offset, offset + block) and [offset + block, offset + 2 block) of the long operand
+        const size_t x_length = min(block, longer.size() - offset);
+        const size_t y_length = min(block, longer.size() - offset - x_length);
+
+        PhaseTimer block_transform_timer(Phase::kTransform);
+        a.assign(n, 0);
+        for (size_t i = 0; i < x_length; ++i)
+            a[i].real(longer[offset + i]);
+        for (size_t i = 0; i < y_length; ++i)
+            a[i].imag(longer[offset + block + i]);
+        context.dft(a);
+        block_transform_timer.stop();
+
+        PhaseTimer pointwise_timer(Phase::kPointwise);
+        for (uint32_t k = 0; k < n; ++k)
+            a[k] = complex_multiply(a[k], spectrum[k]);
+        pointwise_timer.stop();
+
+        PhaseTimer inverse_timer(Phase::kInverseTransform);
+        context.inverse_dft(a);
+        inverse_timer.stop();
+
+        // the last block carries all the rest, the others only the coefficients before the next block
+        const bool last = offset + x_length + y_length == longer.size();
+        accumulate(0, last && y_length == 0 ? x_length + shorter.size() - 1 : x_length);
+        if (y_length > 0)
+            accumulate(1, last ? y_length + shorter.size() - 1 : y_length);
+    }
+    result.push_back(static_cast<uint16_t>(carry));
+
+    if (kStatsCompiled && stats_enabled)
+        multiply_stats.add_rounding_error(error);
+    return error;
+}
+
+// the sum of the products of `pairs`, where a product is negated if `negative[i]`, accumulated in the frequency domain:
+// every pair is packed into one DFT like in `multiply_by_fft`, and the spectra of the products are summed, so that
+// only one inverse transform and one rounding pass are needed for the whole sum. the signed coefficients of the sum are
+// added to `coefficients`, which is extended to the transform length if it's shorter.
+// returns the rounding error, like `multiply_by_fft`
+double dot_product_by_fft(const vector<std::pair<const vector<uint16_t> *, const vector<uint16_t> *>> &pairs,
+                          const vector<bool> &negative, vector<int64_t> &coefficients, MultiplyScratch &scratch) {
+    size_t length = 4;
+    for (const auto &[lhs, rhs] : pairs)
+        length = max(length, lhs->size() + rhs->size());
+    const FFTContext full(length), half(full.n_ / 2);
+    const uint32_t n = full.n_, m = half.n_;
+    if (kStatsCompiled && stats_enabled)
+        multiply_stats.add_transform(n);
+
+    vector<complex<double>> &a = scratch.points_, &sum = scratch.spectrum_;
+    sum.assign(m + 1, 0);
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        PhaseTimer transform_timer(Phase::kTransform);
+        a.assign(n, 0);
+        for (size_t j = 0; j < pairs[i].first->size(); ++j)
+            a[j].real((*pairs[i].first)[j]);
+        for (size_t j = 0; j < pairs[i].second->size(); ++j)
+            a[j].imag((*pairs[i].second)[j]);
+        full.dft(a);
+        transform_timer.stop();
+
+        // the same as `multiply_by_fft`, but added to the sum
+        PhaseTimer pointwise_timer(Phase::kPointwise);
+        const complex<double> factor(0, negative[i] ? 0.25 : -0.25);
+        for (uint32_t k = 0; k <= m; ++k) {
+            complex<double> zk = a[k], zj = conj(a[(n - k) & (n - 1)]);
+            sum[k] += (zk + zj) * (zk - zj) * factor;
+        }
+    }
+
+    PhaseTimer inverse_timer(Phase::kInverseTransform);
+    inverse_real_dft(full, half, sum.data());
+    inverse_timer.stop();
+
+    PhaseTimer carry_timer(Phase::kCarry);
+    coefficients.resize(max<size_t>(coefficients.size(), n));
+    double error = 0;
+    for (uint32_t j = 0; j < m; ++j) {
+        const double real = round(sum[j].real()), imag = round(sum[j].imag());
+        error = max({error, std::abs(sum[j].real() - real), std::abs(sum[j].imag() - imag)});
+        coefficients[2 * j] += static_cast<int64_t>(real);
+        coefficients[2 * j + 1] += static_cast<int64_t>(imag);
+    }
+
+    if (kStatsCompiled && stats_enabled)
+        multiply_stats.add_rounding_error(error);
+    return error;
+}
+
+// copy `digits` to `points`, combining two elements into one base 10^8 point
+void fill_ntt_points(const vector<uint16_t> &digits, vector<uint32_t> &points) {
+    for (size_t i = 0; i < digits.size(); ++i)
+        points[i / 2] += digits[i] * (i % 2 == 0 ? 1 : kDigitRange);
+}
+
+// build the contexts of `scratch` for a product of `length` points. building a context computes its roots, so the ones
+// of the last NTT are kept if they have the same length
+void prepare_ntt(size_t length, MultiplyScratch &scratch) {
+    const auto prepare = [length](auto &context) {
+        using Context = typename std::decay_t<decltype(context)>::element_type;
+        if (context == nullptr || context->n_ < length || context->n_ / 2 >= length)
+            context = std::make_unique<Context>(length);
+    };
+    prepare(scratch.ntt1_);
+    prepare(scratch.ntt2_);
+    prepare(scratch.ntt3_);
+    if (kStatsCompiled && stats_enabled)
+        multiply_stats.add_transform(scratch.ntt1_->n_);
+}
+
+// convolve the operands in `scratch.residues_` modulo each of the three primes, in place.
+// the three convolutions are independent, so they can run on different threads. they are timed as one phase
+// (the transform), as the steps of the three overlap
+void convolve_residues(MultiplyScratch &scratch) {
+    thread_pool().parallel_for(3, [&scratch](size_t modulus) {
+        auto &residues = scratch.residues_;
+        if (modulus == 0)
+            scratch.ntt1_->convolve(residues[0], residues[1]);
+        else if (modulus == 1)
+            scratch.ntt2_->convolve(residues[2], residues[3]);
+        else
+            scratch.ntt3_->convolve(residues[4], residues[5]);
+    });
+}
+
+// since the NTT result is exact, we are no longer bounded by the precision of `double`, so we can use larger
+// points: two elements (8 digits) per point, which halves the transform length compared to FFT
+void multiply_by_ntt(const vector<uint16_t> &lhs_digits, const vector<uint16_t> &rhs_digits,
+                     vector<uint16_t> &result, MultiplyScratch &scratch) {
+    size_t length = (lhs_digits.size() + 1) / 2 + (rhs_digits.size() + 1) / 2;
+    if (length > kNTTMaxLength)
+        throw std::length_error("the operands are too long to multiply by NTT");
+
+    PhaseTimer transform_timer(Phase::kTransform);
+    prepare_ntt(length, scratch);
+
+    auto &[lhs1, rhs1, lhs2, rhs2, lhs3, rhs3] = scratch.residues_;
+    lhs1.assign(scratch.ntt1_->n_, 0);
+    rhs1.assign(scratch.ntt1_->n_, 0);
+    fill_ntt_points(lhs_digits, lhs1);
+    fill_ntt_points(rhs_digits, rhs1);
+    lhs2.assign(lhs1.begin(), lhs1.end());
+    rhs2.assign(rhs1.begin(), rhs1.end());
+    lhs3.assign(lhs1.begin(), lhs1.end());
+    rhs3.assign(rhs1.begin(), rhs1.end());
+
+    // every point is less than 10^8, which is less than all the moduli, so no reduction is needed here
+    convolve_residues(scratch);
+    transform_timer.stop();
+
+    // combine the three residues by CRT, and split every base 10^8 point back to two elements
+    PhaseTimer carry_timer(Phase::kCarry);
+    result.reserve(result.size() + 2 * lhs1.size());
+    uint64_t carry = 0;
+    for (size_t i = 0; i < lhs1.size(); ++i) {
+        uint32_t point = chinese_remainder_carry(lhs1[i], lhs2[i], lhs3[i], kNTTPointRange, carry);
+        result.push_back(static_cast<uint16_t>(point % kDigitRange));
+        result.push_back(static_cast<uint16_t>(point / kDigitRange));
+    }
+    assert(carry == 0);
+}
+
+// the bytes `multiply_by_ntt` takes for a product of `length` points: the two operands modulo the three primes, and
+// the roots of the three contexts
+size_t ntt_workspace(size_t length) {
+    size_t n = 1;
+    while (n < length)
+        n <<= 1;
+    return 9 * n * sizeof(uint32_t);
+}
+
+// the wide limbs `BigInteger` can multiply on (see `LimbPolicy`): 9 digits in a `uint32_t`, 2.25 times the digits of
+// an element. the elements are still what `BigInteger` and `BigDecimal` store and every linear pass works on, so the
+// operands are packed into limbs right before the multiplication, and the product is unpacked right after it.
+// 9 elements are exactly 4 limbs (36 digits), so both conversions work on such groups without any division by a
+// variable, and the cost is linear
+struct Limb32 {
+    using type = uint32_t;
+    static constexpr int kWidth = 9;
+    static constexpr type kBase = 1000000000;
+    static constexpr size_t kGroupElements = 9, kGroupLimbs = 4;
+
+    // the number of limbs `count` elements take
+    static size_t limbs(size_t count) {
+        return (count * kDigitWidth + kWidth - 1) / kWidth;
+    }
+
+    // write the limbs of `digits` to `out`, which must have room for `limbs(digits.size())` of them
+    static void pack(const vector<uint16_t> &digits, type *out) {
+        const size_t count = digits.size(), groups = count / kGroupElements;
+        for (size_t i = 0; i < groups; ++i)
+            pack_group(digits.data() + i * kGroupElements, out + i * kGroupLimbs);
+
+        // the last group is padded by zeros, and only its limbs within `limbs(count)` are written
+        if (count % kGroupElements != 0) {
+            uint16_t elements[kGroupElements] = {};
+            type group[kGroupLimbs];
+            copy(digits.begin() + static_cast<ptrdiff_t>(groups * kGroupElements), digits.end(), elements);
+            pack_group(elements, group);
+            copy_n(group, limbs(count) - groups * kGroupLimbs, out + groups * kGroupLimbs);
+        }
+    }
 
-    explicit number_parse_error(const char *reason) : reason_(reason) {}
+    // append the elements of `count` limbs to `result`, with possible leading zeros
+    static void unpack(const type *limbs, size_t count, vector<uint16_t> &result) {
+        const size_t groups = (count + kGroupLimbs - 1) / kGroupLimbs;
+        size_t size = result.size();
+        result.resize(size + groups * kGroupElements);
+        for (size_t i = 0; i + 1 < groups; ++i, size += kGroupElements)
+            unpack_group(limbs + i * kGroupLimbs, result.data() + size);
+
+        if (groups != 0) {
+            type group[kGroupLimbs] = {};
+            copy(limbs + (groups - 1) * kGroupLimbs, limbs + count, group);
+            unpack_group(group, result.data() + size);
+        }
+    }
 
-    [[nodiscard]] const char* what() const noexcept override {
-        return "failed to parse the input as numbers";
+ private:
+    // the digits of limb j are the digits [9j, 9j + 9) of the number, and the ones of element i are [4i, 4i + 4),
+    // so a limb takes the high part of one element, some whole elements, and the low part of another one
+    static void pack_group(const uint16_t *e, type *out) {
+        out[0] = static_cast<type>(e[0] + e[1] * 10000 + e[2] % 10 * 100000000);
+        out[1] = static_cast<type>(e[2] / 10 + e[3] * 1000 + e[4] % 100 * 10000000);
+        out[2] = static_cast<type>(e[4] / 100 + e[5] * 100 + e[6] % 1000 * 1000000);
+        out[3] = static_cast<type>(e[6] / 1000 + e[7] * 10 + e[8] * 100000);
+    }
+
+    static void unpack_group(const type *limbs, uint16_t *out) {
+        out[0] = static_cast<uint16_t>(limbs[0] % 10000);
+        out[1] = static_cast<uint16_t>(limbs[0] / 10000 % 10000);
+        out[2] = static_cast<uint16_t>(limbs[0] / 100000000 + limbs[1] % 1000 * 10);
+        out[3] = static_cast<uint16_t>(limbs[1] / 1000 % 10000);
+        out[4] = static_cast<uint16_t>(limbs[1] / 10000000 + limbs[2] % 100 * 100);
+        out[5] = static_cast<uint16_t>(limbs[2] / 100 % 10000);
+        out[6] = static_cast<uint16_t>(limbs[2] / 1000000 + limbs[3] % 10 * 1000);
+        out[7] = static_cast<uint16_t>(limbs[3] / 10 % 10000);
+        out[8] = static_cast<uint16_t>(limbs[3] / 100000);
     }
 };
 
-class FFTContext {
-    vector<complex<double>> omega_, omega_inverse_;
+// product scanning on base 10^9 limbs, like `multiply_by_schoolbook`, `out` has `n + m` limbs.
+// a product of two limbs is less than 10^18, so a column is summed in blocks of 18 products (< 1.8 * 10^19 < 2^64),
+// and the sum is folded into the multiples of the base after every block
+void multiply_limbs_by_schoolbook(const uint32_t *a, size_t n, const uint32_t *b, size_t m, uint32_t *out) {
+    constexpr size_t kBlock = 18;
+    constexpr uint64_t kBase = Limb32::kBase;
+    uint64_t carry = 0;
+    for (size_t k = 0; k + 1 < n + m; ++k) {
+        uint64_t low = carry % kBase, high = carry / kBase;
+        const size_t last = min(n, k + 1);
+        for (size_t i = k < m ? 0 : k - m + 1; i < last; ) {
+            for (const size_t end = min(last, i + kBlock); i < end; ++i)
+                low += static_cast<uint64_t>(a[i]) * b[k - i];
+            high += low / kBase;
+            low %= kBase;
+        }
+        out[k] = static_cast<uint32_t>(low);
+        carry = high;
+    }
+    out[n + m - 1] = static_cast<uint32_t>(carry);
+}
+
+// schoolbook on the limbs of `Limb32`, which is faster than Karatsuba and Toom-3 on the elements up to
+// `kTransformThreshold`, as every product covers 5 times the digits
+void multiply_by_wide_schoolbook(const vector<uint16_t> &lhs, const vector<uint16_t> &rhs, vector<uint16_t> &result,
+                                 MultiplyScratch &scratch) {
+    PhaseTimer timer(Phase::kDirectProduct);  // packing and unpacking are interleaved with the products too
+    auto &[a, b, product] = scratch.limbs_;
+    a.resize(Limb32::limbs(lhs.size()));
+    b.resize(Limb32::limbs(rhs.size()));
+    product.resize(a.size() + b.size());
+    Limb32::pack(lhs, a.data());
+    Limb32::pack(rhs, b.data());
+    multiply_limbs_by_schoolbook(a.data(), a.size(), b.data(), b.size(), product.data());
+    Limb32::unpack(product.data(), product.size(), result);
+}
+
+// `multiply_by_ntt` on the limbs of `Limb32`: a point holds 9 digits instead of 8, so the transforms are 1/9 shorter
+// (which halves them whenever that crosses a power of 2), for the price of reducing the limbs modulo every prime
+void multiply_by_wide_ntt(const vector<uint16_t> &lhs_digits, const vector<uint16_t> &rhs_digits,
+                          vector<uint16_t> &result, MultiplyScratch &scratch) {
+    const size_t n = Limb32::limbs(lhs_digits.size()), m = Limb32::limbs(rhs_digits.size()), length = n + m;
+    if (length > kNTTMaxLength)
+        throw std::length_error("the operands are too long to multiply by NTT");
+
+    PhaseTimer transform_timer(Phase::kTransform);
+    prepare_ntt(length, scratch);
+
+    // the limbs are packed into the residues of the first prime, then reduced modulo every prime, since all of them
+    // are less than 10^9. only the `count` limbs are reduced, the padding is zero anyway
+    const uint32_t points = scratch.ntt1_->n_;
+    auto &[lhs1, rhs1, lhs2, rhs2, lhs3, rhs3] = scratch.residues_;
+    const auto reduce = [points](const vector<uint16_t> &digits, size_t count, vector<uint32_t> &residues1,
+                                 vector<uint32_t> &residues2, vector<uint32_t> &residues3) {
+        residues1.assign(points, 0);
+        residues2.assign(points, 0);
+        residues3.assign(points, 0);
+        Limb32::pack(digits, residues1.data());
+        for (size_t i = 0; i < count; ++i) {
+            residues2[i] = residues1[i] % kNTTModulus2;
+            residues3[i] = residues1[i] % kNTTModulus3;
+            residues1[i] %= kNTTModulus1;
+        }
+    };
+    reduce(lhs_digits, n, lhs1, lhs2, lhs3);
+    reduce(rhs_digits, m, rhs1, rhs2, rhs3);
+
+    convolve_residues(scratch);
+    transform_timer.stop();
+
+    // combine the three residues by CRT into the limbs of the product (over the residues of the first prime, which
+    // are read just before), then unpack them
+    PhaseTimer carry_timer(Phase::kCarry);
+    uint64_t carry = 0;
+    for (size_t i = 0; i < length; ++i)
+        lhs1[i] = chinese_remainder_carry(lhs1[i], lhs2[i], lhs3[i], Limb32::kBase, carry);
+    assert(carry == 0);
+    Limb32::unpack(lhs1.data(), length, result);
+}
+
+// which limbs `BigInteger::multiply_into` multiplies on
+//   - kElement: the base 10^4 elements as they are stored
+//   - kWide:    the base 10^9 limbs of `Limb32`, by schoolbook from `kWideSchoolbookThreshold` to
+//               `kTransformThreshold`, and by NTT wherever the elements would use NTT. FFT (and its unbalanced
+//               path) stays on the elements, since the rounding error of wider points would be too large, and so
+//               does the out-of-core NTT
+enum class LimbPolicy { kElement, kWide };
+
+LimbPolicy limb_policy = LimbPolicy::kWide;
+
+// a temporary file of `uint32_t`, which is read and written at explicit offsets, so that only the parts being processed
+// take memory. the file is removed when it's closed, and several threads can access different parts at once
+class SpillFile {
+    std::FILE *file_;
+#if !defined(HAS_POSIX_MMAP)
+    std::mutex mutex_;
+#endif
 
  public:
-    uint32_t n_, k_ = 0;  // n is the maximum size, and n = 1 << k
+    SpillFile() : file_(std::tmpfile()) {
+        if (file_ == nullptr)
+            throw std::runtime_error("Cannot create a temporary file");
+    }
 
-    // initialize an FFT context with maximum length `m`
-    explicit FFTContext(const uint32_t m) {
-        while ((1U << k_) < m)
-            ++k_;
-        n_ = 1U << k_;
+    SpillFile(const SpillFile &) = delete;
+    SpillFile &operator=(const SpillFile &) = delete;
 
-        omega_.reserve(n_ >> 1);
-        omega_inverse_.reserve(n_ >> 1);
-        for (uint32_t i = 0; i < (n_ >> 1); ++i)
-            omega_.emplace_back(cos(2 * M_PI / n_ * i), sin(2 * M_PI / n_ * i));
-        ::transform(omega_.begin(), omega_.end(), back_inserter(omega_inverse_),
-                  [](auto p) { return conj(p); });
+    ~SpillFile() {
+        std::fclose(file_);
     }
 
-    void transform(vector<complex<double>> &a, const vector<complex<double>> &omega) const {
-        assert(a.size() == n_);
+    // write `count` elements of `data` at the offset of `offset` elements
+    void write(size_t offset, const uint32_t *data, size_t count) {
+        const size_t bytes = count * sizeof(uint32_t);
+#if defined(HAS_POSIX_MMAP)
+        for (size_t done = 0; done < bytes;) {
+            const ssize_t written = pwrite(fileno(file_), reinterpret_cast<const char *>(data) + done, bytes - done,
+                                           static_cast<off_t>(offset * sizeof(uint32_t) + done));
+            if (written <= 0)
+                throw std::runtime_error("Cannot write the temporary file");
+            done += static_cast<size_t>(written);
+        }
+#else
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (std::fseek(file_, static_cast<long>(offset * sizeof(uint32_t)), SEEK_SET) != 0 ||
+            std::fwrite(data, 1, bytes, file_) != bytes)
+            throw std::runtime_error("Cannot write the temporary file");
+#endif
+    }
 
-        for (uint32_t i = 0; i < n_; ++i) {
-            // reverse bits using Bit Twiddling Hacks
-            // reference: https://graphics.stanford.edu/~seander/bithacks.html#ReverseParallel
-            uint32_t t = i;
-            t = ((t >> 1) & 0x55555555) | ((t & 0x55555555) << 1);
-            t = ((t >> 2) & 0x33333333) | ((t & 0x33333333) << 2);
-            t = ((t >> 4) & 0x0F0F0F0F) | ((t & 0x0F0F0F0F) << 4);
-            t = ((t >> 8) & 0x00FF00FF) | ((t & 0x00FF00FF) << 8);
-            t = ( t >> 16             ) | ( t               << 16);
+    // read `count` elements at the offset of `offset` elements to `data`
+    void read(size_t offset, uint32_t *data, size_t count) {
+        const size_t bytes = count * sizeof(uint32_t);
+#if defined(HAS_POSIX_MMAP)
+        for (size_t done = 0; done < bytes;) {
+            const ssize_t got = pread(fileno(file_), reinterpret_cast<char *>(data) + done, bytes - done,
+                                      static_cast<off_t>(offset * sizeof(uint32_t) + done));
+            if (got <= 0)
+                throw std::runtime_error("Cannot read the temporary file");
+            done += static_cast<size_t>(got);
+        }
+#else
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (std::fseek(file_, static_cast<long>(offset * sizeof(uint32_t)), SEEK_SET) != 0 ||
+            std::fread(data, 1, bytes, file_) != bytes)
+            throw std::runtime_error("Cannot read the temporary file");
+#endif
+    }
+};
 
-            // general bits reverse is reverse on 32-bit, but we only want to reverse on k-bit,
-            // so we can right shift (32 - k) bits to make things right
-            t >>= (32 - k_);
+// four-step NTT (see `FFTContext::four_step_transform`) of length L = n1 * n2 on an n1 x n2 matrix in a `SpillFile`,
+// so that only a few of its columns or rows are in memory at a time. every pass reads or writes the matrix once: the
+// columns go `columns_` at a time (n1 short reads each time), and the rows `rows_` at a time (one long read).
+// the spectrum is left transposed, that is, X[k1 + n1 k2] is at k1 * n2 + k2, which doesn't matter to the pointwise
+// product, and the inverse transform goes the other way round: the rows, the twiddle factors, then the columns
+template<typename NTT>
+class SpilledNTT {
+ public:
+    using Context = NTT;
 
-            if (i < t)
-                swap(a[i], a[t]);
+ private:
+    uint32_t n1_, n2_, columns_ = 1, rows_ = 1;
+    Context column_context_, row_context_;
+    uint32_t root_, root_inverse_;  // the L-th root of unity and its inverse
+    vector<uint32_t> panel_, lines_;  // a group of columns, one column after another, and the same group row by row
+    vector<uint32_t> sum_, lhs_, rhs_;  // groups of rows
+
+    // n1 of a transform of `length` points. the columns are read in pieces of `tile / n1` points, so the rows are made
+    // as long as `tile` allows, up to a length that still runs in the cache, and at least as long as the columns
+    static uint32_t split(size_t length, size_t tile) {
+        constexpr size_t kMaxRow = 1U << 16;
+        uint32_t k = 0;
+        while ((size_t{1} << k) < length)
+            ++k;
+        size_t n1 = size_t{1} << (k / 2);
+        while (n1 > 1 && 2 * (length / n1) <= min(tile, kMaxRow))
+            n1 >>= 1;
+        return static_cast<uint32_t>(n1);
+    }
+
+    // multiply a[t] by step^t, for 0 <= t < n
+    static void twiddle(uint32_t *a, uint32_t n, uint32_t step) {
+        for (uint32_t t = 0, w = 1; t < n; ++t, w = Context::mul(w, step))
+            a[t] = Context::mul(a[t], w);
+    }
+
+    // move the columns from `first` between `panel_` and the matrix at `offset` of `file`
+    void read_columns(SpillFile &file, size_t offset, uint32_t first) {
+        for (uint32_t r = 0; r < n1_; ++r)
+            file.read(offset + static_cast<size_t>(r) * n2_ + first, lines_.data() + static_cast<size_t>(r) * columns_,
+                      columns_);
+        for (uint32_t r = 0; r < n1_; ++r)
+            for (uint32_t b = 0; b < columns_; ++b)
+                panel_[static_cast<size_t>(b) * n1_ + r] = lines_[static_cast<size_t>(r) * columns_ + b];
+    }
+
+    void write_columns(SpillFile &file, size_t offset, uint32_t first) {
+        for (uint32_t r = 0; r < n1_; ++r)
+            for (uint32_t b = 0; b < columns_; ++b)
+                lines_[static_cast<size_t>(r) * columns_ + b] = panel_[static_cast<size_t>(b) * n1_ + r];
+        for (uint32_t r = 0; r < n1_; ++r)
+            file.write(offset + static_cast<size_t>(r) * n2_ + first, lines_.data() + static_cast<size_t>(r) * columns_,
+                       columns_);
+    }
+
+ public:
+    // a transform of length `length` (a power of two), whose five buffers take at most `tile` elements each, unless a
+    // single row is longer than that
+    SpilledNTT(size_t length, size_t tile)
+        : n1_(split(length, tile)), n2_(static_cast<uint32_t>(length / n1_)), column_context_(n1_), row_context_(n2_),
+          root_(Context::root_of_unity(static_cast<uint32_t>(length))), root_inverse_(Context::inverse(root_)) {
+        while (columns_ < n2_ && 2 * static_cast<size_t>(columns_) * n1_ <= tile)
+            columns_ <<= 1;
+        while (rows_ < n1_ && 2 * static_cast<size_t>(rows_) * n2_ <= tile)
+            rows_ <<= 1;
+        panel_.resize(static_cast<size_t>(columns_) * n1_);
+        lines_.resize(panel_.size());
+        sum_.resize(static_cast<size_t>(rows_) * n2_);
+        lhs_.resize(sum_.size());
+        rhs_.resize(sum_.size());
+    }
+
+    // transform the points `point(j)`, 0 <= j < L, to the matrix at `offset` of `file`
+    template<typename Point>
+    void dft(const Point &point, SpillFile &file, size_t offset) {
+        // 1. on the columns, which are taken from `point` (j = j2 + n2 j1), multiplied by the twiddle factors w^{j2 k1}
+        for (uint32_t first = 0; first < n2_; first += columns_) {
+            for (uint32_t j1 = 0; j1 < n1_; ++j1)
+                for (uint32_t b = 0; b < columns_; ++b)
+                    panel_[static_cast<size_t>(b) * n1_ + j1] = point(static_cast<size_t>(j1) * n2_ + first + b);
+            for (uint32_t b = 0; b < columns_; ++b) {
+                uint32_t *column = panel_.data() + static_cast<size_t>(b) * n1_;
+                column_context_.dft(column);
+                twiddle(column, n1_, Context::pow(root_, first + b));
+            }
+            write_columns(file, offset, first);
         }
 
-        for (uint32_t i = 1; i <= k_; ++i) {
-            uint32_t omega_step = 1U << (k_ - i);
-            for (auto p = a.begin(); p != a.end(); p += 1U << i) {
-                auto l = p, r = p + (1U << (i - 1));
-                for (auto omega_iter = omega.begin(); omega_iter != omega.end(); ++l, ++r, omega_iter += omega_step) {
-                    complex<double> t = (*omega_iter) * (*r);
-                    *r = *l - t;
-                    *l += t;
+        // 2. on the rows
+        for (uint32_t first = 0; first < n1_; first += rows_) {
+            const size_t position = offset + static_cast<size_t>(first) * n2_;
+            file.read(position, sum_.data(), sum_.size());
+            for (uint32_t r = 0; r < rows_; ++r)
+                row_context_.dft(sum_.data() + static_cast<size_t>(r) * n2_);
+            file.write(position, sum_.data(), sum_.size());
+        }
+    }
+
+    // the inverse transform of the sum of the pointwise products of the spectra at the `pairs` of offsets of `lhs` and
+    // `rhs`, to the matrix at `offset` of `out`, in the natural order
+    void inverse_dft_of_products(SpillFile &lhs, SpillFile &rhs, const vector<std::pair<size_t, size_t>> &pairs,
+                                 SpillFile &out, size_t offset) {
+        // 1. on the rows, after the products are summed, then multiplied by the twiddle factors w^{-j2 k1}
+        for (uint32_t first = 0; first < n1_; first += rows_) {
+            const size_t position = static_cast<size_t>(first) * n2_;
+            fill_n(sum_.begin(), sum_.size(), 0);
+            for (auto [lhs_offset, rhs_offset] : pairs) {
+                lhs.read(lhs_offset + position, lhs_.data(), lhs_.size());
+                rhs.read(rhs_offset + position, rhs_.data(), rhs_.size());
+                for (size_t t = 0; t < sum_.size(); ++t)
+                    sum_[t] = Context::add(sum_[t], Context::mul(lhs_[t], rhs_[t]));
+            }
+            for (uint32_t r = 0; r < rows_; ++r) {
+                uint32_t *row = sum_.data() + static_cast<size_t>(r) * n2_;
+                row_context_.inverse_dft(row);
+                twiddle(row, n2_, Context::pow(root_inverse_, first + r));
+            }
+            out.write(offset + position, sum_.data(), sum_.size());
+        }
+
+        // 2. on the columns
+        for (uint32_t first = 0; first < n2_; first += columns_) {
+            read_columns(out, offset, first);
+            for (uint32_t b = 0; b < columns_; ++b)
+                column_context_.inverse_dft(panel_.data() + static_cast<size_t>(b) * n1_);
+            write_columns(out, offset, first);
+        }
+    }
+};
+
+// the same as `multiply_by_ntt`, but the transforms are kept in temporary files, and about `memory_limit` bytes of them
+// are in memory at a time, so that products far longer than the memory are still possible.
+//
+// every transform of length L is a `SpilledNTT`, which costs O(L log L) work, and reads and writes the files a fixed
+// number of times: twice for each forward transform, twice for the inverse one (where the pointwise product is done
+// on the way), and once more to carry the result. the transforms are at most `max_length` points long, which is the
+// largest power of two that divides all the moduli minus 1. a longer product cuts the operands into blocks of L / 2
+// points, transforms every block once, then for every k, sums the products of the spectra of the blocks i and j with
+// i + j = k, and inverts the sum once: that's L / 2 points of the result, and L / 2 points that overlap the next sum.
+// the spectra are read once for every pair of blocks, so only products of more than `kNTTMaxLength` points (about 134
+// million digits) grow with the square of the number of blocks
+void multiply_by_out_of_core_ntt(const vector<uint16_t> &lhs_digits, const vector<uint16_t> &rhs_digits,
+                                 vector<uint16_t> &result, size_t memory_limit, size_t max_length = kNTTMaxLength) {
+    const size_t lhs_points = (lhs_digits.size() + 1) / 2, rhs_points = (rhs_digits.size() + 1) / 2;
+    size_t length = 2;  // L
+    while (length < lhs_points + rhs_points && length < max_length)
+        length <<= 1;
+    const size_t block = lhs_points + rhs_points <= length ? length : length / 2, overlap = length - block;
+    const size_t lhs_blocks = (lhs_points + block - 1) / block, rhs_blocks = (rhs_points + block - 1) / block;
+    const size_t diagonals = lhs_blocks + rhs_blocks - 1;
+
+    // every modulus has five buffers in its `SpilledNTT`, and two more to carry the result. they are at least 256 KiB
+    // each (about 5 MiB in total), below that the columns would be read a few bytes at a time
+    const size_t tile = max<size_t>(memory_limit / (21 * sizeof(uint32_t)), 1U << 16);
+    PhaseTimer transform_timer(Phase::kTransform);
+    SpilledNTT<NTTContext1> ntt1(length, tile);
+    SpilledNTT<NTTContext2> ntt2(length, tile);
+    SpilledNTT<NTTContext3> ntt3(length, tile);
+    if (kStatsCompiled && stats_enabled)
+        multiply_stats.add_transform(length);
+    multiply_stats.add_spilled_product();
+
+    // run `body(modulus, ntt)` for the three moduli on different threads
+    const auto for_each_modulus = [&](const auto &body) {
+        thread_pool().parallel_for(3, [&](size_t modulus) {
+            if (modulus == 0)
+                body(modulus, ntt1);
+            else if (modulus == 1)
+                body(modulus, ntt2);
+            else
+                body(modulus, ntt3);
+        });
+    };
+
+    // the spectrum of the block i of an operand modulo the prime `modulus` is at the offset of (3 i + modulus) L
+    SpillFile lhs_file, rhs_file, product_file;
+    const auto transform_blocks = [&](const vector<uint16_t> &digits, size_t blocks, SpillFile &file) {
+        for (size_t i = 0; i < blocks; ++i) {
+            for_each_modulus([&](size_t modulus, auto &ntt) {
+                const auto point = [&](size_t j) -> uint32_t {
+                    const size_t t = 2 * (i * block + j);
+                    if (j >= block || t >= digits.size())
+                        return 0;
+                    return digits[t] + (t + 1 < digits.size() ? digits[t + 1] * static_cast<uint32_t>(kDigitRange) : 0);
+                };
+                ntt.dft(point, file, (3 * i + modulus) * length);
+            });
+        }
+    };
+    transform_blocks(lhs_digits, lhs_blocks, lhs_file);
+    transform_blocks(rhs_digits, rhs_blocks, rhs_file);
+    transform_timer.stop();
+
+    // carry `count` points of the result: the ones of the sum k (if it's not past the last one) at the offset of
+    // (3 (k mod 2) + modulus) L, plus the upper part of the sum k - 1, which overlaps them
+    std::array<vector<uint32_t>, 3> residues, uppers;
+    const size_t chunk = min(tile, length);
+    result.reserve(result.size() + 2 * (diagonals * block + overlap));
+    uint64_t carry = 0;
+    const auto collect = [&](size_t k, size_t count) {
+        for (size_t first = 0; first < count; first += chunk) {
+            const size_t size = min(chunk, count - first);
+            for_each_modulus([&](size_t modulus, auto &ntt) {
+                using Context = typename std::decay_t<decltype(ntt)>::Context;
+                vector<uint32_t> &points = residues[modulus], &upper = uppers[modulus];
+                points.assign(size, 0);
+                if (k < diagonals)
+                    product_file.read((3 * (k % 2) + modulus) * length + first, points.data(), size);
+                if (k > 0 && first < overlap) {
+                    upper.resize(min(size, overlap - first));
+                    product_file.read((3 * ((k - 1) % 2) + modulus) * length + block + first, upper.data(),
+                                      upper.size());
+                    for (size_t t = 0; t < upper.size(); ++t)
+                        points[t] = Context::add(points[t], upper[t]);
                 }
+            });
+
+            PhaseTimer carry_timer(Phase::kCarry);
+            for (size_t t = 0; t < size; ++t) {
+                uint32_t point = chinese_remainder_carry(residues[0][t], residues[1][t], residues[2][t],
+                                                         kNTTPointRange, carry);
+                result.push_back(static_cast<uint16_t>(point % kDigitRange));
+                result.push_back(static_cast<uint16_t>(point / kDigitRange));
             }
         }
+    };
+
+    // the pointwise products are timed with the inverse transform, since they are done in the same pass
+    for (size_t k = 0; k < diagonals; ++k) {
+        PhaseTimer inverse_timer(Phase::kInverseTransform);
+        for_each_modulus([&](size_t modulus, auto &ntt) {
+            vector<std::pair<size_t, size_t>> pairs;
+            for (size_t i = k < rhs_blocks ? 0 : k - rhs_blocks + 1; i < lhs_blocks && i <= k; ++i)
+                pairs.emplace_back((3 * i + modulus) * length, (3 * (k - i) + modulus) * length);
+            ntt.inverse_dft_of_products(lhs_file, rhs_file, pairs, product_file, (3 * (k % 2) + modulus) * length);
+        });
+        inverse_timer.stop();
+        collect(k, block);
     }
+    collect(diagonals, overlap);
+    assert(carry == 0);
+}
 
-    void dft(vector<complex<double>> &a) const {
-        transform(a, omega_);
+// whether an exact product of `length` points keeps its transforms in temporary files: if they would exceed
+// `transform_memory_limit`, or `kNTTMaxLength`
+bool spills_transforms(size_t length) {
+    return length > kNTTMaxLength || ntt_workspace(length) > transform_memory_limit;
+}
+
+// NTT in memory, or out of core if its transforms don't fit (see `spills_transforms`)
+void multiply_exactly(const vector<uint16_t> &lhs_digits, const vector<uint16_t> &rhs_digits,
+                      vector<uint16_t> &result, MultiplyScratch &scratch) {
+    size_t length = (lhs_digits.size() + 1) / 2 + (rhs_digits.size() + 1) / 2;
+    if (spills_transforms(length))
+        multiply_by_out_of_core_ntt(lhs_digits, rhs_digits, result, transform_memory_limit);
+    else if (limb_policy == LimbPolicy::kWide)
+        multiply_by_wide_ntt(lhs_digits, rhs_digits, result, scratch);
+    else
+        multiply_by_ntt(lhs_digits, rhs_digits, result, scratch);
+}
+
+// which algorithm `BigInteger::operator*` uses
+//   - kFFT:  floating-point FFT, fast, but the rounding error grows with the length
+//   - kNTT:  NTT modulo three primes then CRT, slower by a constant factor, but always exact. the transforms go to
+//            temporary files if they exceed `transform_memory_limit`
+//   - kAuto: schoolbook / Karatsuba / Toom-3 for short operands (see `kTransformThreshold`),
+//            then FFT (by blocks if the operands are unbalanced, see `kUnbalancedRatio`), and NTT when the result
+//            is longer than `kNTTThreshold` elements
+enum class MultiplyEngine { kAuto, kFFT, kNTT };
+
+MultiplyEngine multiply_engine = MultiplyEngine::kAuto;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+// 8 digits to two 4-digit values within a 64-bit integer (SWAR), the first character is the lowest byte, and the
+// value of the first 4 digits is in the low 32 bits. reference: http://0x80.pl/articles/swar-digits-validate.html
+inline uint64_t parse_eight_digits(const char *p) {
+    uint64_t chunk;
+    memcpy(&chunk, p, sizeof(chunk));
+
+    // a byte is a digit iff its high nibble is 3, and it's still 3 after adding 6
+    if (((chunk & 0xf0f0f0f0f0f0f0f0) | (((chunk + 0x0606060606060606) & 0xf0f0f0f0f0f0f0f0) >> 4))
+        != 0x3333333333333333)
+        throw number_parse_error("not digit (0 to 9)");
+
+    // the same as `DecimalParser::parse_sixteen`, combine the neighbouring bytes, then the neighbouring 16-bit lanes
+    chunk -= 0x3030303030303030;
+    chunk = (chunk * 10 + (chunk >> 8)) & 0x00ff00ff00ff00ff;
+    return (chunk * 100 + (chunk >> 16)) & 0x0000ffff0000ffff;
+}
+#endif
+
+// converts decimal characters to base 10^4 elements, 16 (SSE2) or 8 (SWAR) digits per step once they are aligned to
+// the elements, and one by one for the rest.
+//
+// the digits can be fed in several pieces (e.g. the parts before and after the decimal point), from the most
+// significant one. since `BigInteger` stores the elements from the least significant one, they are written backward.
+class DecimalParser {
+    uint16_t *elements_;
+    size_t index_;  // elements [0, index_) are not written yet, the next one to write is `elements_[index_ - 1]`
+    uint32_t value_ = 0;  // the digits collected for the next element
+    int remaining_;  // how many digits the next element still needs
+
+    void parse_one(char digit) {
+        if (digit < '0' || '9' < digit)
+            throw number_parse_error("not digit (0 to 9)");
+
+        value_ = value_ * 10 + static_cast<uint32_t>(digit - '0');
+        if (--remaining_ == 0) {
+            elements_[--index_] = static_cast<uint16_t>(value_);
+            value_ = 0;
+            remaining_ = kDigitWidth;
+        }
     }
 
-    void inverse_dft(vector<complex<double>> &a) const {
-        transform(a, omega_inverse_);
-        for (auto &p : a)
-            p /= n_;
+#if defined(__SSE2__)
+    // 16 digits to 4 elements
+    void parse_sixteen(const char *p) {
+        const __m128i chunk = _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), _mm_set1_epi8('0'));
+        const __m128i invalid = _mm_or_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8(9)),
+                                             _mm_cmplt_epi8(chunk, _mm_setzero_si128()));
+        if (_mm_movemask_epi8(invalid) != 0)
+            throw number_parse_error("not digit (0 to 9)");
+
+        // every 16-bit lane holds two digits "ab" as (b << 8 | a), make it 10a + b,
+        // then every 32-bit lane holds two of them "ab" "cd", make it 100ab + cd
+        __m128i pairs = _mm_add_epi16(_mm_mullo_epi16(_mm_and_si128(chunk, _mm_set1_epi16(0xff)), _mm_set1_epi16(10)),
+                                      _mm_srli_epi16(chunk, 8));
+        __m128i quads = _mm_madd_epi16(pairs, _mm_set1_epi32(1 << 16 | 100));
+
+        // the most significant element is in the lowest lane, reverse them to the storage order
+        __m128i elements = _mm_shufflelo_epi16(_mm_packs_epi32(quads, quads), 0x1b);
+        index_ -= 4;
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(elements_ + index_), elements);
+    }
+#endif
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // 8 digits to 2 elements
+    void parse_eight(const char *p) {
+        const uint64_t chunk = parse_eight_digits(p);
+        elements_[--index_] = static_cast<uint16_t>(chunk);
+        elements_[--index_] = static_cast<uint16_t>(chunk >> 32);
+    }
+#endif
+
+ public:
+    // `elements` has exactly `ceil(length / kDigitWidth)` elements, `length` is the total number of digits
+    DecimalParser(uint16_t *elements, size_t length)
+            : elements_(elements), index_((length + kDigitWidth - 1) / kDigitWidth),
+              remaining_(static_cast<int>((length + kDigitWidth - 1) % kDigitWidth) + 1) {}
+
+    // parse the following digits, throw `number_parse_error` if there is any character other than '0' to '9'
+    void parse(string_view digits) {
+        const char *p = digits.data(), *end = digits.data() + digits.size();
+
+        // complete the current element, so that the following digits are aligned to the elements
+        while (remaining_ != kDigitWidth && p != end)
+            parse_one(*p++);
+
+#if defined(__SSE2__)
+        for (; end - p >= 16; p += 16)
+            parse_sixteen(p);
+#endif
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        for (; end - p >= 8; p += 8)
+            parse_eight(p);
+#endif
+        while (p != end)
+            parse_one(*p++);
+    }
+
+    // whether all the elements are written
+    [[nodiscard]] bool finished() const {
+        return index_ == 0 && value_ == 0;
     }
 };
 
-class BigDecimal;  // declare here, so we can declare friend function inside BigInteger
+// "00" to "99", so that an element is formatted by two lookups
+const char *digit_pairs() {
+    static const std::array<char, 200> pairs = []() {
+        std::array<char, 200> table{};
+        for (int i = 0; i < 100; ++i) {
+            table[2 * i] = static_cast<char>('0' + i / 10);
+            table[2 * i + 1] = static_cast<char>('0' + i % 10);
+        }
+        return table;
+    }();
+    return pairs.data();
+}
 
-class BigInteger {
- public:
-    constexpr static int kDigitWidth = 4;
-    constexpr static int kDigitRange = 10000;
+#if defined(__SSE2__)
+// 8 elements to 32 digits, `elements[7]` is the most significant one
+void format_eight(const uint16_t *elements, char *out) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(elements));
+
+    // reverse the 16-bit lanes, so that the most significant element goes first
+    chunk = _mm_shuffle_epi32(chunk, 0x1b);
+    chunk = _mm_shufflehi_epi16(_mm_shufflelo_epi16(chunk, 0xb1), 0xb1);
+
+    // split every element e into e / 100 and e % 100, where e / 100 = (e * 5243) >> 19 for e < 43699
+    const __m128i high = _mm_srli_epi16(_mm_mulhi_epu16(chunk, _mm_set1_epi16(5243)), 3);
+    const __m128i low = _mm_sub_epi16(chunk, _mm_mullo_epi16(high, _mm_set1_epi16(100)));
+
+    // split every x into x / 10 in the low byte and x % 10 in the high byte, where x / 10 = (x * 103) >> 10 for
+    // x < 179, then the bytes are exactly the characters in order
+    const auto split = [](__m128i x) {
+        __m128i tens = _mm_srli_epi16(_mm_mullo_epi16(x, _mm_set1_epi16(103)), 10);
+        __m128i ones = _mm_sub_epi16(x, _mm_mullo_epi16(tens, _mm_set1_epi16(10)));
+        return _mm_add_epi8(_mm_or_si128(tens, _mm_slli_epi16(ones, 8)), _mm_set1_epi8('0'));
+    };
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), split(_mm_unpacklo_epi16(high, low)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 16), split(_mm_unpackhi_epi16(high, low)));
+}
+#endif
+
+// format `count` elements to `count * kDigitWidth` digits, from the most significant one (`elements[count - 1]`)
+void format_elements(const uint16_t *elements, size_t count, char *out) {
+#if defined(__SSE2__)
+    for (; count >= 8; count -= 8, out += 8 * kDigitWidth)
+        format_eight(elements + count - 8, out);
+#endif
+
+    const char *pairs = digit_pairs();
+    for (; count > 0; --count, out += kDigitWidth) {
+        uint16_t element = elements[count - 1];
+        memcpy(out, pairs + 2 * (element / 100), 2);
+        memcpy(out + 2, pairs + 2 * (element % 100), 2);
+    }
+}
 
+class BigDecimal;  // declare here, so we can make it a friend of BigInteger
+
+class BigInteger {
  private:
     bool positive_;
-    vector<uint16_t> digits_;  // one element is `kDigitWidth` digits
+    vector<uint16_t> digits_;  // one element is `kDigitWidth` digits, from the least significant one
 
  public:
     BigInteger() : positive_(true), digits_() {}
 
-    explicit BigInteger(string_view number) : positive_(true) {
+    explicit BigInteger(string_view number) : BigInteger(number, string_view()) {}
+
+    // parse the concatenation of `high` and `low` (e.g. the parts before and after the decimal point) without
+    // building it, only `high` may have the negative sign
+    BigInteger(string_view high, string_view low) {
+        parse(high, low);
+    }
+
+    // the same as the constructor, but reuses the memory this integer already has
+    void parse(string_view high, string_view low) {
+        PhaseTimer timer(Phase::kParse);
+
         // check negative or positive
-        if (!number.empty() && number[0] == '-') {
+        positive_ = true;
+        if (!high.empty() && high[0] == '-') {
             positive_ = false;
-            number.remove_prefix(1);
+            high.remove_prefix(1);
         }
-        number.remove_prefix(min(number.size(), number.find_first_not_of('0')));  // remove leading zeros
 
-        // check whether all digits are '0' to '9'
-        if (find_if_not(number.begin(), number.end(),
-                        [](char digit) { return '0' <= digit && digit <= '9'; }) != number.end()) {
-            throw number_parse_error("not digit (0 to 9)");
-        }
-
-        // copy and transform digits to elements (`digits_`)
-        //
-        // `j` is how many digits should be in `digits_[0]`
-        // consider a number:   "123 4567 8901", and `kDigitWidth` = 4
-        //                       ---
-        //                    j = 3, means that 3 digits "123" should be put in `digits_[0]`
-        decltype(digits_)::value_type j = (number.length() - 1) % kDigitWidth + 1;
-        digits_.reserve(number.length() / kDigitWidth + 1);
-        size_t value = 0;  // temporary buffer
-        for (char digit : number) {
-            value = value * 10 + (digit - '0');
-            if ((--j) == 0) {
-                // if we have collected all the digits that one element of `digits_[ ]` needs, that is, `j == 0`,
-                // we push it to `digits_` and reset `value`
-                digits_.push_back(value);
-                value = 0;
-                j = kDigitWidth;  // reset counter `j`
-            }
-        }
-        assert(value == 0 && j == kDigitWidth);  // assert all digits are exactly put in `digits_`
-        assert(digits_.size() <= number.length() / kDigitWidth + 1);  // assert the served space is enough
+        // remove leading zeros
+        high.remove_prefix(min(high.size(), high.find_first_not_of('0')));
+        if (high.empty())
+            low.remove_prefix(min(low.size(), low.find_first_not_of('0')));
+
+        // since `digits_` is from the least significant element, the parser fills it from the end, and the most
+        // significant element gets the remainder digits, i.e. "123 4567 8901" is {8901, 4567, 123}
+        digits_.resize((high.length() + low.length() + kDigitWidth - 1) / kDigitWidth);
+        DecimalParser parser(digits_.data(), high.length() + low.length());
+        parser.parse(high);
+        parser.parse(low);
+        assert(parser.finished());  // assert all digits are exactly put in `digits_`
     }
 
     // trim leading zero elements
     void trim_leading_zeros() {
-        // find first non-zero digit
-        auto non_zero = find_if_not(digits_.begin(), digits_.end(), [](auto digit) { return digit == 0; });
-        digits_.erase(digits_.begin(), non_zero);  // then erase the leading zeros
+        while (!digits_.empty() && digits_.back() == 0)
+            digits_.pop_back();
     }
 
     // get string representation of the integer, and the length of the string must be a multiple of 4
     // note: there may be several leading or trailing zeros, since it's expensive to trim single zeros
     [[nodiscard]] string get_number_string() const {
-        string s;
-        s.reserve(digits_.size() * kDigitWidth);
-
-        char buffer[kDigitWidth];
-        for (auto element : digits_) {
-            // first, serialize each element to a 4 digits string into `buffer`,
-            // the most significant digit is at the end of `buffer`
-            for (char &digit : buffer) {
-                digit = static_cast<char>(element % 10 + '0');
-                element /= 10;
-            }
+        string s(digits_.size() * kDigitWidth, '0');
+        format_elements(digits_.data(), digits_.size(), s.data());
+        return s;
+    }
 
-            // put content of `buffer` to `s` in reverse order (from the most significant digit to the least one)
-            for (int i = kDigitWidth - 1; i >= 0; --i)
-                s.push_back(buffer[i]);
-        }
+    // the number of zeros at the beginning of `get_number_string()`
+    [[nodiscard]] size_t leading_zeros() const {
+        size_t zeros = 0;
+        auto iter = digits_.rbegin();
+        for (; iter != digits_.rend() && *iter == 0; ++iter)
+            zeros += kDigitWidth;
+        for (uint16_t bound = kDigitRange / 10; iter != digits_.rend() && *iter < bound; bound /= 10)
+            ++zeros;
+        return zeros;
+    }
 
-        assert(s.length() == digits_.size() * kDigitWidth);  // assert reserved space is enough
-        return s;
+    // the number of zeros at the end of `get_number_string()`
+    [[nodiscard]] size_t trailing_zeros() const {
+        size_t zeros = 0;
+        auto iter = digits_.begin();
+        for (; iter != digits_.end() && *iter == 0; ++iter)
+            zeros += kDigitWidth;
+        for (uint16_t element = iter == digits_.end() ? 1 : *iter; element % 10 == 0; element /= 10)
+            ++zeros;
+        return zeros;
     }
 
-    BigInteger operator*(const BigInteger &other) const {
-        BigInteger result;
+    // write the digits [first, first + count) of `get_number_string()` to `out`, without building the whole string
+    void write_digits(size_t first, size_t count, char *out) const {
+        // the i-th element from the most significant one is `digits_[top - i]`
+        const size_t top = digits_.size() - 1;
+        size_t index = first / kDigitWidth, offset = first % kDigitWidth;
+        char element[kDigitWidth];
+
+        // the first element may be written partially
+        if (offset != 0 && count != 0) {
+            format_elements(&digits_[top - index], 1, element);
+            size_t length = min(count, kDigitWidth - offset);
+            memcpy(out, element + offset, length);
+            out += length, count -= length, ++index;
+        }
 
-        // simple formula to determinate whether it's positive, and can be easily proved by drawing a truth table
-        result.positive_ = !positive_ ^ other.positive_;
-
-        // prepare FFT context:
-        // for two numbers with length `x` and `y`, the length of the multiplication result will be at most `x + y`
-        FFTContext context(digits_.size() + other.digits_.size());
-        vector<complex<double>> lhs(context.n_), rhs(context.n_);
-
-        // copy the digits to FFT coefficients:
-        // when we store digits, we place the digits to array from the most significant digit (in `digits_[0]`) to the
-        // least significant digit. but when we perform FFT, the coefficients should be placed from the least
-        // significant digit (in `digits_[0]`) to the most significant digit. so we need to copy `digits_` to
-        // `vector<complex<double>>` in reverse order
-        copy(digits_.rbegin(), digits_.rend(), lhs.begin());
-        copy(other.digits_.rbegin(), other.digits_.rend(), rhs.begin());
-
-        // multiply via FFT:
-        // first we transform the polynomial from coefficient representation to point-value representation by DFT
-        context.dft(lhs);
-        context.dft(rhs);
-        // then we perform multiplication on the point values, "lhs <- lhs * rhs"
-        transform(lhs.begin(), lhs.end(), rhs.begin(), lhs.begin(), [](auto x, auto y) { return x * y; });
-        // next we transform the polynomial from point-value representation back to coefficient representation by I-DFT
-        context.inverse_dft(lhs);
-
-        // collect results from the polynomial, or you can just think that substituting x = 10 into the polynomial to
-        // calculate the value
-        result.digits_.reserve(context.n_);
-        int64_t carry = 0;
-        for (const auto &p : lhs) {
-            carry += static_cast<decltype(carry)>(round(p.real()));
-            result.digits_.push_back(static_cast<decltype(digits_[0])>(carry % kDigitRange));
-            carry /= kDigitRange;
+        size_t whole = count / kDigitWidth;
+        format_elements(digits_.data() + top + 1 - index - whole, whole, out);
+        out += whole * kDigitWidth, count -= whole * kDigitWidth, index += whole;
+
+        // so as the last one
+        if (count != 0) {
+            format_elements(&digits_[top - index], 1, element);
+            memcpy(out, element, count);
         }
+    }
 
-        // reverse the digits, the reason is same as why copying in reverse order above
-        reverse(result.digits_.begin(), result.digits_.end());
+    // multiply `lhs` and `rhs` into `result`, reusing the memory `result` already has, and working in `scratch`.
+    // `result` can be one of the operands, then the product is computed in `scratch` and swapped into it
+    static void multiply_into(const BigInteger &lhs, const BigInteger &rhs, BigInteger &result,
+                              MultiplyScratch &scratch) {
+        // simple formula to determinate whether it's positive, and can be easily proved by drawing a truth table
+        const bool positive = !lhs.positive_ ^ rhs.positive_;
+        vector<uint16_t> &digits = &result == &lhs || &result == &rhs ? scratch.product_ : result.digits_;
+        digits.clear();
+
+        // zero multiplied by anything is zero, and this also saves us from a transform of length 0
+        if (!lhs.digits_.empty() && !rhs.digits_.empty()) {
+            size_t shorter = min(lhs.digits_.size(), rhs.digits_.size());
+            size_t length = lhs.digits_.size() + rhs.digits_.size();
+            bool automatic = multiply_engine == MultiplyEngine::kAuto, wide = limb_policy == LimbPolicy::kWide;
+            // the transforms of the unbalanced path are short, so it's accurate even if the product is long
+            bool unbalanced = length - shorter >= kUnbalancedRatio * shorter && 2 * shorter <= kNTTThreshold;
+            double error = 0;
+            if (automatic && shorter < (wide ? kWideSchoolbookThreshold : kKaratsubaThreshold))
+                multiply_by_schoolbook(lhs.digits_, rhs.digits_, digits);
+            else if (automatic && wide && shorter < kTransformThreshold)
+                multiply_by_wide_schoolbook(lhs.digits_, rhs.digits_, digits, scratch);
+            else if (automatic && shorter < kTransformThreshold)
+                multiply_by_polynomial(lhs.digits_, rhs.digits_, digits, scratch);
+            else if (multiply_engine != MultiplyEngine::kNTT && unbalanced)
+                error = multiply_by_chunked_fft(lhs.digits_, rhs.digits_, digits, scratch);
+            else if (multiply_engine == MultiplyEngine::kNTT || (automatic && length > kNTTThreshold))
+                multiply_exactly(lhs.digits_, rhs.digits_, digits, scratch);
+            else
+                error = multiply_by_fft(lhs.digits_, rhs.digits_, digits, scratch);
+
+            if (error > fft_error_bound) {
+                // the rounding may have gone wrong, so the product is redone exactly
+                multiply_stats.add_fft_fallback();
+                digits.clear();
+                multiply_exactly(lhs.digits_, rhs.digits_, digits, scratch);
+            }
+        }
 
+        if (&digits != &result.digits_)
+            swap(digits, result.digits_);
+        result.positive_ = positive;
         result.trim_leading_zeros();  // standardization
+
+        if (kStatsCompiled && stats_enabled)
+            multiply_stats.add_multiplication(scratch.bytes());
+    }
+
+    // the same, but the working memory is allocated for this multiplication only
+    static void multiply_into(const BigInteger &lhs, const BigInteger &rhs, BigInteger &result) {
+        MultiplyScratch scratch;
+        multiply_into(lhs, rhs, result, scratch);
+    }
+
+    BigInteger operator*(const BigInteger &other) const {
+        BigInteger result;
+        multiply_into(*this, other, result);
         return result;
     }
 
+    // the product of all the factors (1 if there is none) by a product tree: the neighbors are multiplied in pairs,
+    // then the products in pairs, and so on, so that every multiplication is between numbers of similar lengths,
+    // unlike the chain ((a b) c) d..., where a long product is multiplied by a short factor again and again.
+    //
+    // the pairs of a level are independent, so they are distributed to the thread pool, and every thread keeps one
+    // scratch through all the levels. when a level has only one pair, it runs on the calling thread, so that the
+    // multiplication itself can use the pool
+    static BigInteger multiply_all(vector<BigInteger> factors) {
+        if (factors.empty())
+            return BigInteger("1");
+
+        ThreadPool &pool = thread_pool();
+        vector<MultiplyScratch> scratches(pool.size());
+        vector<BigInteger> products;
+        while (factors.size() > 1) {
+            const size_t pairs = factors.size() / 2;
+            products.resize((factors.size() + 1) / 2);
+            if (factors.size() % 2 != 0)
+                products.back() = std::move(factors.back());
+
+            std::atomic<size_t> next{0};
+            const auto multiply_pairs = [&](size_t slot) {
+                for (size_t i; (i = next.fetch_add(1)) < pairs; )
+                    multiply_into(factors[2 * i], factors[2 * i + 1], products[i], scratches[slot]);
+            };
+            if (pairs == 1)
+                multiply_pairs(0);
+            else
+                pool.parallel_for(min(pool.size(), pairs), multiply_pairs);
+
+            swap(factors, products);  // the old factors are reused for the products of the next level
+        }
+        return std::move(factors.front());
+    }
+
+    // the length of `get_number_string()`
+    [[nodiscard]] size_t number_string_length() const {
+        return digits_.size() * kDigitWidth;
+    }
+
     [[nodiscard]] bool is_positive() const {
         return positive_;
     }
 
-    friend ostream &operator<<(ostream &stream, const BigDecimal &decimal);
+    friend class BigDecimal;
 };
 
 class BigDecimal {
@@ -241,9 +2501,16 @@ class BigDecimal {
     int64_t exponent_;
 
  public:
-    explicit BigDecimal(BigInteger &&mantissa, int64_t exponent) : mantissa_(mantissa), exponent_(exponent) {}
+    explicit BigDecimal(BigInteger &&mantissa, int64_t exponent) : mantissa_(std::move(mantissa)), exponent_(exponent) {}
+
+    BigDecimal() : exponent_(0) {}
 
     explicit BigDecimal(string_view number) {
+        parse(number);
+    }
+
+    // the same as the constructor, but reuses the memory this decimal already has
+    void parse(string_view number) {
         if (!number.empty() && number[0] == '+')
             number.remove_prefix(1);  // remove leading "+"
 
@@ -271,22 +2538,23 @@ class BigDecimal {
         string_view part1 = number.substr(0, dot_pos);
         string_view part2 = e_pos == dot_pos ? "" : number.substr(dot_pos + 1, e_pos - dot_pos - 1);
 
-        // parse mantissa
-        string mantissa_part;
-        mantissa_part.reserve(part1.length() + part2.length());
-        mantissa_part.append(part1).append(part2);  // skip '.' and parse mantissa part
-        mantissa_ = BigInteger(mantissa_part);
+        // parse mantissa, skip '.' between part1 and part2
+        mantissa_.parse(part1, part2);
 
         // parse exponent
         if (e_pos_iter == number.end()) {  // if 'e' not found
             exponent_ = 0;
         } else {
-            char *str_end;
-            errno = 0;  // reset errno
-            exponent_ = strtoll(number.substr(e_pos + 1).data(), &str_end, 10);
-            if (errno == ERANGE)  // explicit error occurred
+            // `from_chars` never reads past the view, which may not be null-terminated (e.g. a mapped file)
+            string_view exponent = number.substr(e_pos + 1);
+            if (exponent.size() > 1 && exponent[0] == '+' && exponent[1] != '-')
+                exponent.remove_prefix(1);  // `from_chars` does not accept the leading '+'
+
+            exponent_ = 0;  // an empty exponent is zero
+            auto [end, error] = std::from_chars(exponent.data(), exponent.data() + exponent.size(), exponent_);
+            if (error == std::errc::result_out_of_range)  // explicit error occurred
                 throw number_parse_error("exponent out of range");
-            if (str_end != number.end())  // did not parse the whole string (stopped in the middle)
+            if (end != exponent.data() + exponent.size())  // did not parse the whole string (stopped in the middle)
                 throw number_parse_error("invalid exponent");
         }
         exponent_ -= static_cast<int64_t>(part2.length());  // do not forget the decimal part in part2
@@ -299,105 +2567,548 @@ class BigDecimal {
         return BigDecimal(std::move(mantissa), exponent);
     }
 
-    friend ostream &operator<<(ostream &stream, const BigDecimal &decimal);
-};
+    // the sum of lhs[i] * rhs[i]. the products are aligned to the smallest exponent, and the pairs with transform
+    // lengths are summed in the frequency domain (see `dot_product_by_fft`), so they cost one inverse transform and one
+    // carry pass in total, instead of one per product. the short pairs are multiplied one by one, and only their
+    // coefficients are summed. all the pairs are summed that way if the products are too long for FFT (see
+    // `kNTTThreshold`), or if the rounding error of the sum would be too large
+    static BigDecimal dot_product(const vector<BigDecimal> &lhs, const vector<BigDecimal> &rhs) {
+        if (lhs.size() != rhs.size())
+            throw std::invalid_argument("the operands of dot_product have different lengths");
+
+        // the zero products are skipped, so that their exponents don't matter
+        vector<size_t> nonzero;
+        int64_t exponent = std::numeric_limits<int64_t>::max();
+        for (size_t i = 0; i < lhs.size(); ++i) {
+            if (!lhs[i].mantissa_.digits_.empty() && !rhs[i].mantissa_.digits_.empty()) {
+                nonzero.push_back(i);
+                exponent = min(exponent, lhs[i].exponent_ + rhs[i].exponent_);
+            }
+        }
+        BigDecimal result;
+        if (nonzero.empty())
+            return result;
+
+        // lhs[i] * 10^(its exponent - `exponent`), so that all the products have the same exponent
+        vector<BigInteger> aligned(nonzero.size());
+        vector<std::pair<const vector<uint16_t> *, const vector<uint16_t> *>> transformed;
+        vector<bool> negative(nonzero.size()), transformed_negative;
+        vector<size_t> direct;
+        size_t length = 0;
+        for (size_t t = 0; t < nonzero.size(); ++t) {
+            const BigDecimal &x = lhs[nonzero[t]], &y = rhs[nonzero[t]];
+            const auto shift = static_cast<size_t>(x.exponent_ + y.exponent_ - exponent);
+            aligned[t].digits_.assign(shift / kDigitWidth, 0);
+            uint32_t carry = 0, scale = 1;
+            for (size_t i = 0; i < shift % kDigitWidth; ++i)
+                scale *= 10;
+            for (uint16_t element : x.mantissa_.digits_) {
+                carry += element * scale;
+                aligned[t].digits_.push_back(static_cast<uint16_t>(carry % kDigitRange));
+                carry /= kDigitRange;
+            }
+            aligned[t].digits_.push_back(static_cast<uint16_t>(carry));
+            aligned[t].trim_leading_zeros();
+            negative[t] = x.mantissa_.positive_ != y.mantissa_.positive_;
+
+            const vector<uint16_t> &a = aligned[t].digits_, &b = y.mantissa_.digits_;
+            length = max(length, a.size() + b.size());
+            if (min(a.size(), b.size()) >= kTransformThreshold) {
+                transformed.emplace_back(&a, &b);
+                transformed_negative.push_back(negative[t]);
+            } else {
+                direct.push_back(t);
+            }
+        }
 
-ostream &operator<<(ostream &stream, const BigDecimal &decimal) {
-    // special condition for 0
-    if (decimal.mantissa_.digits_.empty())
-        return stream << '0';
-
-    // serialize `mantissa` to string, then make it into `string_view`, so that we can easily cut the slice
-    string mantissa_part = decimal.mantissa_.get_number_string();
-    string_view mantissa_view = mantissa_part;
-
-    // assert that it's at least one non-zero digits, that is, return value of `find_first_not_of` won't be `npos`
-    // because every `BigDecimal` instance is well trimmed, so if all the digits are zero, then it will be trimmed to
-    // empty (`digits_` is empty), and this case is already handled by the if on the head of this function,
-    // so here there are at least one non-zero digits.
-    assert(mantissa_view.find_first_not_of('0') != string::npos);
-    // trim leading zeros of `mantissa_view`
-    mantissa_view.remove_prefix(mantissa_view.find_first_not_of('0'));
-
-    // how many digits should be print before decimal point '.'
+        MultiplyScratch scratch;
+        vector<int64_t> coefficients(length, 0);
+        BigInteger product;
+        const auto add_product = [&](size_t t) {
+            BigInteger::multiply_into(aligned[t], rhs[nonzero[t]].mantissa_, product, scratch);
+            for (size_t i = 0; i < product.digits_.size(); ++i)
+                coefficients[i] += negative[t] ? -product.digits_[i] : product.digits_[i];
+        };
+
+        if (!transformed.empty()) {
+            if (length <= kNTTThreshold &&
+                dot_product_by_fft(transformed, transformed_negative, coefficients, scratch) <= fft_error_bound) {
+                transformed.clear();
+            } else {
+                if (length <= kNTTThreshold)
+                    multiply_stats.add_fft_fallback();
+                fill_n(coefficients.begin(), coefficients.size(), 0);
+                direct.resize(nonzero.size());
+                for (size_t t = 0; t < direct.size(); ++t)
+                    direct[t] = t;
+            }
+        }
+        for (size_t t : direct)
+            add_product(t);
+
+        carry_signed(coefficients, result.mantissa_);
+        result.exponent_ = exponent;
+        return result;
+    }
+
+    // the product of all the factors (1 if there is none), see `BigInteger::multiply_all`
+    static BigDecimal multiply_all(const vector<BigDecimal> &factors) {
+        vector<BigInteger> mantissas;
+        mantissas.reserve(factors.size());
+        int64_t exponent = 0;
+        for (const BigDecimal &factor : factors) {
+            mantissas.push_back(factor.mantissa_);
+            exponent += factor.exponent_;
+        }
+        return BigDecimal(BigInteger::multiply_all(std::move(mantissas)), exponent);
+    }
+
+    // the product, but only its first `digits` significant digits are exact, which is all that the scientific notation
+    // with `digits - 1` digits after '.' prints. the cost depends on `digits`, instead of the length of the operands.
     //
-    // consider mantissa is "12345", there are some cases for `integer_length`:
-    // 1. when `integer_length` =  2, then the result is "12.345", a simple case
-    // 2. when `integer_length` =  8 > 5, it means "[12345]000", note that we need to fill trailing zeros
-    // 3. when `integer_length` = -2 < 0, it means "0.00[12345]", note that we need to fill zeros after '.'
-    int64_t integer_length = static_cast<int64_t>(mantissa_view.length()) + decimal.exponent_;
-
-    // trim trailing zeros of `mantissa_view`, note that it should be done after `integer_length`
-    assert(mantissa_view.find_last_not_of('0') != string::npos);  // assert it's at least one non-zero digits, too
-    mantissa_view.remove_suffix(mantissa_view.size() - mantissa_view.find_last_not_of('0') - 1);
-
-    // negative sign
-    if (!decimal.mantissa_.positive_)
-        stream << '-';
-
-    // if so, print in scientific notation
-    if (stream.flags() & std::ios_base::scientific) {
-        int64_t precision = stream.precision();
-        int64_t output_exponent = integer_length - 1;  // integer part has only 1 digit, so subtract 1
-
-        stream << mantissa_view[0];  // integer part
-
-        // skip if precision is zero or no more digits need to be printed
-        if (precision > 0 && mantissa_view.length() > 1)
-            stream << '.' << mantissa_view.substr(1, precision);  // `precision` too big won't cause overflow
-        char exponent_sign = output_exponent >= 0 ? '+' : '-';
-        stream << 'e' << exponent_sign << abs(output_exponent);
-    } else {
-        if (integer_length <= 0) {  // if integer part is zero, then print one '0'
-            stream << '0';
+    // let A and B have n and m elements, their top k elements A' and B' are multiplied, and the columns below k - 1 of
+    // the product are dropped, which gives X. then with R = kDigitRange, and shift = n + m - k - 1:
+    //     A B - A' B' R^(n + m - 2k) <= A (B mod R^(m - k)) + (A mod R^(n - k)) B < 2 R^(n + m - k)
+    //     A' B' - X R^(k - 1) < sum_{c < k - 1} (c + 1) R^(c + 2) < 2 (k - 1) R^k
+    // so X R^shift <= A B < (X + 2kR) R^shift. if X and X + 2kR have the same first `digits` digits, so does A B, and
+    // if X has nonzero digits after them, so does A B, then both print the same. otherwise (rarely, when the digits
+    // after them are all 9s or 0s), it falls back to the full product
+    static BigDecimal multiply_significant(const BigDecimal &lhs, const BigDecimal &rhs, size_t digits) {
+        const vector<uint16_t> &a = lhs.mantissa_.digits_, &b = rhs.mantissa_.digits_;
+        const size_t k = (digits + kDigitWidth - 1) / kDigitWidth + kShortProductGuard;
+
+        BigDecimal result;
+        MultiplyScratch scratch;
+        // the full product is used if it's not longer than the short one, or if an operand is zero, which has no
+        // elements to cut
+        if (!a.empty() && !b.empty() && a.size() + b.size() > 2 * k) {
+            BigInteger &x = result.mantissa_;
+            if (k < kTransformThreshold) {
+                multiply_by_short_product(a, b, k, x.digits_, scratch);
+                if (kStatsCompiled && stats_enabled)
+                    multiply_stats.add_multiplication(scratch.bytes());
+            } else {
+                // FFT computes all the columns anyway, so the top elements are simply multiplied
+                BigInteger a_top, b_top;
+                a_top.digits_.resize(k);
+                b_top.digits_.resize(k);
+                copy(a.end() - static_cast<ptrdiff_t>(min(k, a.size())), a.end(), a_top.digits_.end() - min(k, a.size()));
+                copy(b.end() - static_cast<ptrdiff_t>(min(k, b.size())), b.end(), b_top.digits_.end() - min(k, b.size()));
+                BigInteger::multiply_into(a_top, b_top, x, scratch);
+                x.digits_.erase(x.digits_.begin(), x.digits_.begin() + static_cast<ptrdiff_t>(k - 1));
+            }
+            x.trim_leading_zeros();
+            x.positive_ = !lhs.mantissa_.positive_ ^ rhs.mantissa_.positive_;
+
+            BigInteger upper = x;
+            for (size_t i = 1, carry = 2 * k; carry != 0; ++i) {
+                while (i >= upper.digits_.size())
+                    upper.digits_.push_back(0);
+                carry += upper.digits_[i];
+                upper.digits_[i] = static_cast<uint16_t>(carry % kDigitRange);
+                carry /= kDigitRange;
+            }
+
+            const size_t significant = x.number_string_length() - x.leading_zeros() - x.trailing_zeros();
+            if (significant > digits && same_significant_digits(x, upper, digits)) {
+                const auto shift = static_cast<int64_t>(a.size() + b.size()) - static_cast<int64_t>(k + 1);
+                result.exponent_ = lhs.exponent_ + rhs.exponent_ + shift * kDigitWidth;
+                return result;
+            }
+        }
+
+        multiply_into(lhs, rhs, result, scratch);
+        return result;
+    }
+
+    // the same as `BigInteger::multiply_into`, `result` can be one of the operands
+    static void multiply_into(const BigDecimal &lhs, const BigDecimal &rhs, BigDecimal &result,
+                              MultiplyScratch &scratch) {
+        int64_t exponent = lhs.exponent_ + rhs.exponent_;
+        BigInteger::multiply_into(lhs.mantissa_, rhs.mantissa_, result.mantissa_, scratch);
+        result.exponent_ = exponent;
+    }
+
+    static void multiply_into(const BigDecimal &lhs, const BigDecimal &rhs, BigDecimal &result) {
+        MultiplyScratch scratch;
+        multiply_into(lhs, rhs, result, scratch);
+    }
+
+ private:
+    // carry the signed coefficients in base `kDigitRange` to `result`, whose sign is the sign of their value
+    static void carry_signed(vector<int64_t> &coefficients, BigInteger &result) {
+        PhaseTimer timer(Phase::kCarry);
+        result.positive_ = true;
+        while (true) {
+            result.digits_.clear();
+            int64_t carry = 0;
+            for (int64_t coefficient : coefficients) {
+                carry += coefficient;
+                int64_t element = carry % kDigitRange;
+                carry = carry / kDigitRange - (element < 0 ? 1 : 0);  // rounded down, so that the elements are >= 0
+                result.digits_.push_back(static_cast<uint16_t>(element < 0 ? element + kDigitRange : element));
+            }
+            for (; carry > 0; carry /= kDigitRange)
+                result.digits_.push_back(static_cast<uint16_t>(carry % kDigitRange));
+
+            // a negative carry left means the value is negative, then its absolute value is carried instead
+            if (carry == 0)
+                break;
+            for (int64_t &coefficient : coefficients)
+                coefficient = -coefficient;
+            result.positive_ = false;
+        }
+        result.trim_leading_zeros();
+    }
+
+    // whether the first `digits` significant digits of `x` and `y` are the same, and they have the same length
+    static bool same_significant_digits(const BigInteger &x, const BigInteger &y, size_t digits) {
+        const size_t x_zeros = x.leading_zeros(), y_zeros = y.leading_zeros();
+        const size_t length = x.number_string_length() - x_zeros;
+        if (length != y.number_string_length() - y_zeros)
+            return false;
+
+        string x_digits(min(digits, length), '0'), y_digits(x_digits.size(), '0');
+        x.write_digits(x_zeros, x_digits.size(), x_digits.data());
+        y.write_digits(y_zeros, y_digits.size(), y_digits.data());
+        return x_digits == y_digits;
+    }
+
+ public:
+    // format in fixed notation, or in scientific notation with at most `precision` digits after '.', to `out`.
+    // the size of the output is computed first, and if it's larger than `capacity`, nothing is written, otherwise
+    // every digit is written directly to its place. either way, the size is returned (like `snprintf`)
+    size_t format_to(char *out, size_t capacity, bool scientific, int64_t precision) const {
+        PhaseTimer timer(Phase::kFormat);
+
+        // special condition for 0
+        if (mantissa_.digits_.empty()) {
+            if (capacity >= 1)
+                *out = '0';
+            return 1;
+        }
+
+        // the significant digits are [first, first + length) of `mantissa_.get_number_string()`
+        //
+        // because every `BigDecimal` instance is well trimmed, if all the digits are zero, then it will be trimmed to
+        // empty (`digits_` is empty), and this case is already handled above, so here there are at least one
+        // non-zero digits, and `length` > 0
+        const size_t total = mantissa_.digits_.size() * kDigitWidth;
+        const size_t first = mantissa_.leading_zeros(), length = total - first - mantissa_.trailing_zeros();
+        const auto digits = [this, first](size_t begin, size_t count, char *to) {
+            mantissa_.write_digits(first + begin, count, to);
+            return to + count;
+        };
+
+        // how many digits should be print before decimal point '.'
+        //
+        // consider mantissa is "12345", there are some cases for `integer_length`:
+        // 1. when `integer_length` =  2, then the result is "12.345", a simple case
+        // 2. when `integer_length` =  8 > 5, it means "[12345]000", note that we need to fill trailing zeros
+        // 3. when `integer_length` = -2 < 0, it means "0.00[12345]", note that we need to fill zeros after '.'
+        const int64_t integer_length = static_cast<int64_t>(total - first) + exponent_;
+        const size_t sign = mantissa_.positive_ ? 0 : 1;
+
+        size_t size;
+        if (scientific) {
+            // integer part has only 1 digit, and `precision` too big won't cause overflow. the exponent is
+            // `integer_length - 1`, its magnitude is computed in unsigned arithmetic, so nothing can overflow
+            const bool exponent_positive = integer_length >= 1;
+            const auto magnitude = static_cast<uint64_t>(integer_length);
+            const size_t fraction = precision > 0 ? min(static_cast<size_t>(precision), length - 1) : 0;
+            const string exponent = std::to_string(exponent_positive ? magnitude - 1 : 1 - magnitude);
+
+            size = sign + 1 + (fraction > 0 ? 1 + fraction : 0) + 2 + exponent.length();
+            if (size > capacity)
+                return size;
+
+            char *to = digits(0, 1, out + sign);
+            if (fraction > 0) {
+                *to++ = '.';
+                to = digits(1, fraction, to);
+            }
+            *to++ = 'e';
+            *to++ = exponent_positive ? '+' : '-';
+            copy(exponent.begin(), exponent.end(), to);
+        } else if (integer_length <= 0) {
+            // if integer part is zero, print "0." and fill zeros after '.' before printing mantissa (case 3)
+            const auto zeros = static_cast<size_t>(-integer_length);
+
+            size = sign + 2 + zeros + length;
+            if (size > capacity)
+                return size;
+
+            char *to = out + sign;
+            *to++ = '0';
+            *to++ = '.';
+            digits(0, length, fill_n(to, zeros, '0'));
         } else {
-            // determinate how many characters in `mantissa_view` need to print
-            int64_t view_length = min(integer_length, static_cast<int64_t>(mantissa_view.length()));
+            // print mantissa to integer part, and fill trailing zeros if `mantissa_` is not enough (case 2),
+            // then print the rest digits as the decimal part
+            const auto integer_digits = static_cast<size_t>(min(integer_length, static_cast<int64_t>(length)));
+            const size_t zeros = static_cast<size_t>(integer_length) - integer_digits;
+            const size_t decimal_digits = length - integer_digits;
+
+            size = sign + integer_digits + zeros + (decimal_digits > 0 ? 1 + decimal_digits : 0);
+            if (size > capacity)
+                return size;
+
+            char *to = fill_n(digits(0, integer_digits, out + sign), zeros, '0');
+            if (decimal_digits > 0) {
+                *to++ = '.';
+                digits(integer_digits, decimal_digits, to);
+            }
+        }
+
+        // negative sign
+        if (sign != 0)
+            *out = '-';
+        return size;
+    }
+
+    [[nodiscard]] string format(bool scientific, int64_t precision) const {
+        string s(format_to(nullptr, 0, scientific, precision), '\0');
+        format_to(s.data(), s.size(), scientific, precision);
+        return s;
+    }
+};
+
+ostream &operator<<(ostream &stream, const BigDecimal &decimal) {
+    // format the whole number into one buffer, then write it at once
+    string s = decimal.format(stream.flags() & std::ios_base::scientific, stream.precision());
+    return stream.write(s.data(), static_cast<std::streamsize>(s.size()));
+}
+
+// multiply the pairs "A B" read line by line from `in`, and write every product as one line to `out`.
+// the numbers and the output buffer are reused across the lines, so small products cost little more than parsing.
+// the output is flushed whenever no more input is buffered, so it works as a stream when the input is interactive.
+// a line that cannot be parsed gets an empty line, and the reason is reported to `err`.
+// returns the number of lines that failed
+size_t multiply_lines(std::istream &in, ostream &out, ostream &err, bool scientific, int64_t precision) {
+    constexpr size_t kFlushSize = 1 << 16;
+    constexpr char kSpaces[] = " \t\r";
+
+    BigDecimal lhs, rhs, result;
+    MultiplyScratch scratch;  // the lines are usually of similar lengths, so the memory is reused
+    string line, buffer;
+    size_t line_number = 0, failures = 0;
+    while (std::getline(in, line)) {
+        ++line_number;
+        string_view view = line;
+
+        // split the line into two tokens
+        string_view tokens[2];
+        for (string_view &token : tokens) {
+            view.remove_prefix(min(view.size(), view.find_first_not_of(kSpaces)));
+            token = view.substr(0, view.find_first_of(kSpaces));
+            view.remove_prefix(token.size());
+        }
+        view.remove_prefix(min(view.size(), view.find_first_not_of(kSpaces)));
+
+        try {
+            if (tokens[1].empty() || !view.empty())
+                throw number_parse_error("expected two numbers in a line");
+            lhs.parse(tokens[0]);
+            rhs.parse(tokens[1]);
+            if (scientific)  // only the printed digits are computed
+                result = BigDecimal::multiply_significant(lhs, rhs, static_cast<size_t>(max<int64_t>(precision, 0)) + 1);
+            else
+                BigDecimal::multiply_into(lhs, rhs, result, scratch);
+
+            size_t offset = buffer.size();
+            buffer.resize(offset + result.format_to(nullptr, 0, scientific, precision));
+            result.format_to(buffer.data() + offset, buffer.size() - offset, scientific, precision);
+        } catch (number_parse_error &e) {
+            err << "Line " << line_number << " cannot be interpreted as numbers: " << e.reason_ << '\n';
+            ++failures;
+        }
+        buffer.push_back('\n');
+
+        if (buffer.size() >= kFlushSize || in.rdbuf()->in_avail() <= 0) {
+            out.write(buffer.data(), static_cast<std::streamsize>(buffer.size())).flush();
+            buffer.clear();
+        }
+    }
+
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size())).flush();
+    return failures;
+}
+
+// the whole content of a file, without the surrounding spaces and line breaks. it's mapped into memory when possible,
+// so that the number is parsed directly from the page cache, without being copied or limited by ARG_MAX
+class InputFile {
+    string_view content_;
+#if defined(HAS_POSIX_MMAP)
+    void *address_ = nullptr;
+    size_t size_ = 0;
+#else
+    string buffer_;
+#endif
 
-            // print mantissa to integer part
-            stream << mantissa_view.substr(0, view_length);
-            mantissa_view.remove_prefix(view_length);
-            integer_length -= view_length;
+ public:
+    explicit InputFile(const char *path) {
+#if defined(HAS_POSIX_MMAP)
+        int fd = open(path, O_RDONLY);
+        struct stat status{};
+        if (fd == -1 || fstat(fd, &status) == -1) {
+            if (fd != -1)
+                close(fd);
+            throw std::runtime_error(string("Cannot open the file: ") + path);
+        }
 
-            // fill trailing zeros, if `mantissa_` is not enough (case 2)
-            fill_n(ostream_iterator<char>(stream), integer_length, '0');
+        size_ = static_cast<size_t>(status.st_size);
+        if (size_ != 0) {
+            address_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address_ == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error(string("Cannot map the file: ") + path);
+            }
+            madvise(address_, size_, MADV_SEQUENTIAL);  // it's read only once, from the beginning
         }
+        close(fd);  // the mapping is still valid after closing
+        content_ = string_view(static_cast<const char *>(address_), size_);
+#else
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            throw std::runtime_error(string("Cannot open the file: ") + path);
+        buffer_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        content_ = buffer_;
+#endif
+
+        constexpr char kSpaces[] = " \t\r\n";
+        content_.remove_prefix(min(content_.size(), content_.find_first_not_of(kSpaces)));
+        content_.remove_suffix(content_.size() - (content_.find_last_not_of(kSpaces) + 1));
+    }
 
-        // if `mantissa_view` is not empty, we need to print decimal part
-        if (!mantissa_view.empty()) {
-            stream << '.';
+    InputFile(const InputFile &) = delete;
+    InputFile &operator=(const InputFile &) = delete;
 
-            // if `integer_length < 0`, we need to fill zeros after '.' before printing mantissa (case 3)
-            fill_n(ostream_iterator<char>(stream), -integer_length, '0');
+    ~InputFile() {
+#if defined(HAS_POSIX_MMAP)
+        if (size_ != 0)
+            munmap(address_, size_);
+#endif
+    }
+
+    [[nodiscard]] string_view content() const {
+        return content_;
+    }
+};
 
-            stream << mantissa_view;
+// create the file `path` of `size` bytes, and let `produce` write the content to the given address.
+// the file is mapped into memory and written in place, so that no other buffer as large as the output is needed
+void write_file(const char *path, size_t size, const std::function<void(char *)> &produce) {
+#if defined(HAS_POSIX_MMAP)
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
+        throw std::runtime_error(string("Cannot open the file: ") + path);
+
+    if (size != 0) {
+        void *address = ftruncate(fd, static_cast<off_t>(size)) == -1
+                        ? MAP_FAILED : mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error(string("Cannot write the file: ") + path);
         }
+        produce(static_cast<char *>(address));
+        munmap(address, size);
     }
+    close(fd);
+#else
+    string buffer(size, '\0');
+    produce(buffer.data());
+    std::ofstream file(path, std::ios::binary);
+    if (!file.write(buffer.data(), static_cast<std::streamsize>(size)))
+        throw std::runtime_error(string("Cannot write the file: ") + path);
+#endif
+}
 
-    return stream;
+// the peak resident set size of this process in bytes, or 0 if it's unknown
+size_t peak_resident_set_size() {
+#if defined(HAS_POSIX_MMAP)
+    struct rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == -1)
+        return 0;
+#if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss);  // in bytes on macOS
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;  // in kilobytes on Linux and BSD
+#endif
+#else
+    return 0;
+#endif
 }
 
 struct options {
+    vector<const char *> factors;  // A, B and more factors from the command line
+    bool batch = false;
+    const char *batch_file = nullptr;  // read from stdin if it's null
+    const char *multiplier_file = nullptr, *multiplicand_file = nullptr;  // read A and B from the files if not null
+    const char *output_file = nullptr;  // write the product to the file if not null
     bool scientific = false;
     int64_t scientific_precision = -1;
+    MultiplyEngine engine = MultiplyEngine::kAuto;
+    size_t threads = 0;  // 0 means one thread per core
+    size_t memory = std::numeric_limits<size_t>::max();  // `transform_memory_limit` in bytes
+    bool stats = false;
 };
 
 void print_help(const char *executable) {
-    cout << "USAGE: " << executable << " <A> <B> [options...]" << endl;
+    cout << "USAGE: " << executable << " <A> <B> [<C>...] [options...]" << endl;
+    cout << "       " << executable << " --batch [FILE] [options...]" << endl;
+    cout << "       " << executable << " --file <FILE_A> <FILE_B> [options...]" << endl;
     cout << R"(
 ARGUMENTS:
   <A> <B>                 The multiplier and multiplicand
                           You can use either fixed number (i.e. 10.17) or scientific notation (i.e. 1.017e+01)
+  <C>...                  More factors, all of them are multiplied together by a product tree
+  -b, --batch [FILE]      Read "A B" from every line of FILE (or stdin if it's omitted), and print the products line
+                          by line. A line that cannot be parsed gets an empty line, and the error is printed to stderr
+  -f, --file <A> <B>      Read the multiplier and multiplicand from the files, which can be far larger than the
+                          command line allows. The peak memory usage is printed to stderr
 
 OPTIONS:
   -s, --scientific [N]    Print in scientific notation. If N is supplied, the precision of mantissa will be set to N
+  -e, --engine <E>        Multiplication algorithm: "fft", "ntt" (exact, slower) or "auto" (default)
+  -o, --output <FILE>     Write the product to FILE instead of the standard output
+  -j, --threads <N>       Number of threads used by the multiplication of huge numbers, defaults to the number of cores
+  -m, --memory <MiB>      Limit the memory of the exact transforms, the longer ones are kept in temporary files, so
+                          that products larger than the memory are possible, by a few passes over those files
+  --stats                 Print the time of every phase (parsing, transforms, carrying, formatting...), the transform
+                          length, the peak scratch memory and the max FFT rounding error to stderr
 )";
 }
 
+// whether a command line argument is a number rather than an option, negative numbers start with '-' too
+bool is_number_argument(const char *argument) {
+    return argument[0] != '-' || isdigit(static_cast<unsigned char>(argument[1])) || argument[1] == '.';
+}
+
 options parse_options(int argc, char *argv[]) {
     options option;
 
-    if (argc < 3) {
+    // skip program name and the factors (at least A and B)
+    int first_option = 1;
+    while (first_option < argc && is_number_argument(argv[first_option]))
+        option.factors.push_back(argv[first_option++]);
+
+    if (argc >= 2 && (!strcmp(argv[1], "-b") || !strcmp(argv[1], "--batch"))) {
+        // no A, B in batch mode, but an optional file
+        option.batch = true;
+        first_option = 2;
+        if (argc > 2 && argv[2][0] != '-') {
+            option.batch_file = argv[2];
+            first_option = 3;
+        }
+    } else if (argc >= 2 && (!strcmp(argv[1], "-f") || !strcmp(argv[1], "--file"))) {
+        if (argc < 4) {
+            cerr << "You input less files than expected, use \"--help\" for help" << endl;
+            exit(1);
+        }
+        option.multiplier_file = argv[2];
+        option.multiplicand_file = argv[3];
+        first_option = 4;
+    } else if (option.factors.size() < 2) {
         if (argc == 2 && (!strcmp(argv[1], "-h") || !strcmp(argv[1], "--help"))) {
             print_help(argv[0]);
             exit(0);
@@ -407,8 +3118,7 @@ options parse_options(int argc, char *argv[]) {
         }
     }
 
-    // skip program name and A, B, starts with 3
-    for (int i = 3; i < argc; i++) {
+    for (int i = first_option; i < argc; i++) {
         if (!strcmp("-s", argv[i]) || !strcmp("--scientific", argv[i])) {
             option.scientific = true;
 
@@ -423,6 +3133,66 @@ options parse_options(int argc, char *argv[]) {
             continue;
         }
 
+        if ((!strcmp("-e", argv[i]) || !strcmp("--engine", argv[i])) && i + 1 < argc) {
+            const char *engine = argv[++i];
+            if (!strcmp("fft", engine)) {
+                option.engine = MultiplyEngine::kFFT;
+            } else if (!strcmp("ntt", engine)) {
+                option.engine = MultiplyEngine::kNTT;
+            } else if (!strcmp("auto", engine)) {
+                option.engine = MultiplyEngine::kAuto;
+            } else {
+                cerr << "Unrecognized engine: " << engine << endl;
+                exit(1);
+            }
+            continue;
+        }
+
+        if ((!strcmp("-o", argv[i]) || !strcmp("--output", argv[i])) && i + 1 < argc) {
+            option.output_file = argv[++i];
+            continue;
+        }
+
+        if ((!strcmp("-j", argv[i]) || !strcmp("--threads", argv[i])) && i + 1 < argc) {
+            const char *threads = argv[++i];
+            try {
+                size_t end;
+                long long count = std::stoll(threads, &end);
+                if (count <= 0 || threads[end] != '\0')
+                    throw std::invalid_argument(threads);
+                option.threads = static_cast<size_t>(count);
+            } catch (std::logic_error &) {
+                cerr << "Invalid number of threads: " << threads << endl;
+                exit(1);
+            }
+            continue;
+        }
+
+        if ((!strcmp("-m", argv[i]) || !strcmp("--memory", argv[i])) && i + 1 < argc) {
+            const char *memory = argv[++i];
+            try {
+                size_t end;
+                long long mebibytes = std::stoll(memory, &end);
+                if (mebibytes < 0 || memory[end] != '\0' ||
+                    static_cast<unsigned long long>(mebibytes) > std::numeric_limits<size_t>::max() >> 20)
+                    throw std::invalid_argument(memory);
+                option.memory = static_cast<size_t>(mebibytes) << 20;
+            } catch (std::logic_error &) {
+                cerr << "Invalid memory limit: " << memory << endl;
+                exit(1);
+            }
+            continue;
+        }
+
+        if (!strcmp("--stats", argv[i])) {
+            if (!kStatsCompiled) {
+                cerr << "The statistics are not compiled in (built with MUL_STATS=0)" << endl;
+                exit(1);
+            }
+            option.stats = true;
+            continue;
+        }
+
         cerr << "Unrecognized option: " << argv[i] << endl;
         cerr << "Maybe you input more numbers than expected" << endl;
         exit(1);
@@ -436,25 +3206,93 @@ int main(int argc, char *argv[]) {
     std::ios_base::sync_with_stdio(false);
 
     options option = parse_options(argc, argv);
+    multiply_engine = option.engine;
+    transform_memory_limit = option.memory;
+    stats_enabled = option.stats;
+    if (option.threads != 0)
+        set_thread_count(option.threads);
     if (option.scientific) {
         cout << std::scientific;
         if (option.scientific_precision != -1)
             cout.precision(option.scientific_precision);
     }
 
+    if (option.batch) {
+        std::ifstream file;
+        if (option.batch_file != nullptr) {
+            file.open(option.batch_file);
+            if (!file) {
+                cerr << "Cannot open the file: " << option.batch_file << endl;
+                return 1;
+            }
+        }
+        std::istream &in = option.batch_file != nullptr ? file : std::cin;
+
+        try {
+            const size_t failures = multiply_lines(in, cout, cerr, option.scientific, cout.precision());
+            if (option.stats)
+                cerr << multiply_stats.report() << std::flush;
+            return failures == 0 ? 0 : 1;
+        } catch (exception &e) {
+            cerr << "Unknown exception: " << e.what() << endl;
+            return 1;
+        }
+    }
+
     try {
-        // parse number from `argv[1]` and `argv[2]` respectively, then multiply them
-        BigDecimal multiplier(argv[1]), multiplicand(argv[2]);
-        BigDecimal result = multiplier * multiplicand;
+        vector<BigDecimal> factors(2);
+        if (option.multiplier_file != nullptr) {
+            // the files are unmapped right after parsing, so that only the numbers stay in memory
+            InputFile multiplier_input(option.multiplier_file), multiplicand_input(option.multiplicand_file);
+            factors[0].parse(multiplier_input.content());
+            factors[1].parse(multiplicand_input.content());
+        } else {
+            // parse the numbers from `argv[1]`, `argv[2]`...
+            factors.resize(option.factors.size());
+            for (size_t i = 0; i < factors.size(); ++i)
+                factors[i].parse(option.factors[i]);
+        }
 
-        cout << multiplier << " * " << multiplicand << " = " << result << endl;
+        // in scientific notation, only the printed digits (one before '.' and the precision after it) are computed
+        const auto significant_digits = static_cast<size_t>(max<std::streamsize>(cout.precision(), 0)) + 1;
+        BigDecimal result;
+        if (factors.size() > 2)
+            result = BigDecimal::multiply_all(factors);
+        else if (option.scientific)
+            result = BigDecimal::multiply_significant(factors[0], factors[1], significant_digits);
+        else
+            result = factors[0] * factors[1];
+
+        if (option.output_file != nullptr) {
+            // only the product is written, with a line break
+            const bool scientific = option.scientific;
+            const int64_t precision = cout.precision();
+            const size_t size = result.format_to(nullptr, 0, scientific, precision);
+            write_file(option.output_file, size + 1, [&](char *out) {
+                result.format_to(out, size, scientific, precision);
+                out[size] = '\n';
+            });
+        } else if (option.multiplier_file != nullptr) {
+            cout << result << endl;
+        } else {
+            for (const BigDecimal &factor : factors)
+                cout << factor << (&factor != &factors.back() ? " * " : " = ");
+            cout << result << endl;
+        }
     } catch (number_parse_error &e) {
         cerr << "The input cannot be interpreted as numbers: " << e.reason_ << endl;
         return 1;
+    } catch (std::runtime_error &e) {  // cannot read or write the files
+        cerr << e.what() << endl;
+        return 1;
     } catch (exception &e) {
         cerr << "Unknown exception: " << e.what() << endl;
         return 1;
     }
 
+    if (option.stats)
+        cerr << multiply_stats.report() << std::flush;
+    if (option.multiplier_file != nullptr)
+        cerr << "Peak resident set size: " << peak_resident_set_size() / 1024 << " KiB" << endl;
     return 0;
 }
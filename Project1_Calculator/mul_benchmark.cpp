@@ -1,4 +1,5 @@
 #include <benchmark/benchmark.h>
+#include <iomanip>
 #include <random>
 
 #define main main2
@@ -59,7 +60,116 @@ static void BM_BigDecimalParsing(benchmark::State &state) {
 BENCHMARK(BM_BigDecimalParsing)
     ->RangeMultiplier(10)->Range(10, 10000000)->Complexity(benchmark::oN);
 
+static void BM_BigDecimalFormatting(benchmark::State &state) {
+    string x(state.range(0), '0');
+    generate_random_digits(x);
+    x[x.length() / 2] = '.';
+    BigDecimal decimal(x);
+
+    ostringstream stream;
+    if (state.range(1) != 0)
+        stream << std::scientific << std::setprecision(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        stream.str("");
+        stream << decimal;
+
+        benchmark::DoNotOptimize(stream);
+        benchmark::ClobberMemory();
+    }
+    state.SetComplexityN(state.range(0));
+}
+
+// the second argument is whether to print in scientific notation
+BENCHMARK(BM_BigDecimalFormatting)
+    ->ArgsProduct({benchmark::CreateRange(10, 10000000, 10), {0, 1}});
+
+// a forward transform of length 2^range(0), by the radix-2 kernel (range(1) = 0) or the default one (range(1) = 1).
+// the input is copied in every iteration (which is included), otherwise it would grow to infinity
+static void BM_FFTTransform(benchmark::State &state) {
+    FFTContext context(1U << state.range(0));
+    vector<complex<double>> original(context.n_), data(context.n_);
+    uniform_real_distribution<> distrib(0, 9999);
+    generate(original.begin(), original.end(), [&distrib]() { return complex<double>(distrib(rng), distrib(rng)); });
+
+    fft_kernel = state.range(1) == 0 ? FFTKernel::kRadix2 : FFTKernel::kAuto;
+    for (auto _ : state) {
+        copy(original.begin(), original.end(), data.begin());
+        context.dft(data);
+
+        benchmark::DoNotOptimize(data);
+        benchmark::ClobberMemory();
+    }
+    fft_kernel = FFTKernel::kAuto;
+}
+BENCHMARK(BM_FFTTransform)->ArgsProduct({{6, 9, 12, 15, 16, 17, 18}, {0, 1}});
+
 static void BM_BigIntegerMultiply(benchmark::State &state) {
+    string x(state.range(0), '0'), y(state.range(0), '0');
+    for (auto _ : state) {
+        state.PauseTiming();
+        generate_random_digits(x);
+        generate_random_digits(y);
+        BigInteger lhs(x), rhs(y);
+        state.ResumeTiming();
+
+        BigInteger result = lhs * rhs;
+
+        benchmark::DoNotOptimize(result);
+        benchmark::ClobberMemory();
+    }
+    state.SetComplexityN(state.range(0));
+}
+
+BENCHMARK(BM_BigIntegerMultiply)
+    ->RangeMultiplier(10)->Range(10, 1000000)->Complexity(benchmark::oNLogN);
+
+// the same multiplication on base 10^4 elements (0) and on base 10^9 limbs (1), the packing included,
+// by the automatic tiers or by NTT
+static void BM_LimbPolicyMultiply(benchmark::State &state) {
+    string x(state.range(2), '0'), y(state.range(2), '0');
+    generate_random_digits(x);
+    generate_random_digits(y);
+    BigInteger lhs(x), rhs(y), result;
+    MultiplyScratch scratch;
+    limb_policy = state.range(0) == 0 ? LimbPolicy::kElement : LimbPolicy::kWide;
+    multiply_engine = state.range(1) == 0 ? MultiplyEngine::kAuto : MultiplyEngine::kNTT;
+
+    for (auto _ : state) {
+        BigInteger::multiply_into(lhs, rhs, result, scratch);
+
+        benchmark::DoNotOptimize(result);
+        benchmark::ClobberMemory();
+    }
+    limb_policy = LimbPolicy::kWide;
+    multiply_engine = MultiplyEngine::kAuto;
+}
+
+BENCHMARK(BM_LimbPolicyMultiply)
+    ->ArgNames({"wide", "ntt", "n"})
+    ->ArgsProduct({{0, 1}, {0}, {32, 64, 128, 256, 512, 1000}})
+    ->ArgsProduct({{0, 1}, {1}, {1000, 1100, 5000, 30000, 1000000}})
+    ->Unit(benchmark::kMicrosecond);
+
+// packing `range(0)` digits into base 10^9 limbs and unpacking them back, which every wide product pays on top
+static void BM_LimbPolicyConversion(benchmark::State &state) {
+    vector<uint16_t> elements(state.range(0) / kDigitWidth), unpacked;
+    uniform_int_distribution<int> distrib(0, kDigitRange - 1);
+    generate(elements.begin(), elements.end(), [&distrib]() { return static_cast<uint16_t>(distrib(rng)); });
+    vector<uint32_t> limbs(Limb32::limbs(elements.size()));
+
+    for (auto _ : state) {
+        Limb32::pack(elements, limbs.data());
+        unpacked.clear();
+        Limb32::unpack(limbs.data(), limbs.size(), unpacked);
+
+        benchmark::DoNotOptimize(unpacked);
+        benchmark::ClobberMemory();
+    }
+}
+
+BENCHMARK(BM_LimbPolicyConversion)->RangeMultiplier(100)->Range(100, 10000000);
+
+static void BM_BigIntegerSquare(benchmark::State &state) {
     string x(state.range(0), '0');
     for (auto _ : state) {
         state.PauseTiming();
@@ -75,7 +185,264 @@ static void BM_BigIntegerMultiply(benchmark::State &state) {
     state.SetComplexityN(state.range(0));
 }
 
-BENCHMARK(BM_BigIntegerMultiply)
+BENCHMARK(BM_BigIntegerSquare)
+    ->RangeMultiplier(10)->Range(10, 1000000)->Complexity(benchmark::oNLogN);
+
+// repeated multiplications into the same result, with a fresh scratch every time (range(1) = 0), or the same one
+static void BM_BigIntegerMultiplyScratch(benchmark::State &state) {
+    string x(state.range(0), '0'), y(state.range(0), '0');
+    generate_random_digits(x);
+    generate_random_digits(y);
+    BigInteger lhs(x), rhs(y), result;
+    MultiplyScratch scratch;
+
+    for (auto _ : state) {
+        if (state.range(1) == 0)
+            BigInteger::multiply_into(lhs, rhs, result);
+        else
+            BigInteger::multiply_into(lhs, rhs, result, scratch);
+
+        benchmark::DoNotOptimize(result);
+        benchmark::ClobberMemory();
+    }
+}
+
+BENCHMARK(BM_BigIntegerMultiplyScratch)
+    ->ArgNames({"n", "reuse"})->ArgsProduct({{200, 1000, 10000, 100000, 1000000}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+
+// a long operand times a short one, by one FFT of the whole product (algorithm = 0), or by blocks (algorithm = 1),
+// used to find `kUnbalancedRatio`
+static void BM_BigIntegerUnbalanced(benchmark::State &state) {
+    const size_t n = state.range(1), m = n * state.range(2);
+    uniform_int_distribution<int> distrib(0, kDigitRange - 1);
+    vector<uint16_t> lhs(n), rhs(m), result;
+    generate(lhs.begin(), lhs.end(), [&distrib]() { return static_cast<uint16_t>(distrib(rng)); });
+    generate(rhs.begin(), rhs.end(), [&distrib]() { return static_cast<uint16_t>(distrib(rng)); });
+    MultiplyScratch scratch;
+
+    for (auto _ : state) {
+        result.clear();
+        if (state.range(0) == 0)
+            multiply_by_fft(lhs, rhs, result, scratch);
+        else
+            multiply_by_chunked_fft(lhs, rhs, result, scratch);
+
+        benchmark::DoNotOptimize(result);
+        benchmark::ClobberMemory();
+    }
+}
+
+BENCHMARK(BM_BigIntegerUnbalanced)
+    ->ArgNames({"algorithm", "n", "ratio"})->ArgsProduct({{0, 1}, {300, 5000, 50000}, {2, 4, 8, 64}})
+    ->Unit(benchmark::kMicrosecond);
+
+// NTT in memory (memory = 0), or out of core in temporary files with the given MiB of memory
+static void BM_BigIntegerOutOfCoreNTT(benchmark::State &state) {
+    const auto n = static_cast<size_t>(state.range(0));
+    uniform_int_distribution<int> distrib(0, kDigitRange - 1);
+    vector<uint16_t> lhs(n), rhs(n), result;
+    generate(lhs.begin(), lhs.end(), [&distrib]() { return static_cast<uint16_t>(distrib(rng)); });
+    generate(rhs.begin(), rhs.end(), [&distrib]() { return static_cast<uint16_t>(distrib(rng)); });
+    MultiplyScratch scratch;
+
+    for (auto _ : state) {
+        result.clear();
+        if (state.range(1) == 0)
+            multiply_by_ntt(lhs, rhs, result, scratch);
+        else
+            multiply_by_out_of_core_ntt(lhs, rhs, result, static_cast<size_t>(state.range(1)) << 20);
+
+        benchmark::DoNotOptimize(result);
+        benchmark::ClobberMemory();
+    }
+}
+
+BENCHMARK(BM_BigIntegerOutOfCoreNTT)
+    ->ArgNames({"n", "memory"})->ArgsProduct({{1 << 18, 1 << 21}, {0, 4, 32}})->Unit(benchmark::kMillisecond);
+
+// the product of n factors of 100 digits, by the product tree (tree = 1), or by the chain ((a b) c) d...
+static void BM_BigIntegerMultiplyAll(benchmark::State &state) {
+    vector<BigInteger> factors;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        string x(100, '0');
+        generate_random_digits(x);
+        factors.emplace_back(x);
+    }
+
+    for (auto _ : state) {
+        BigInteger product("1");
+        if (state.range(1) == 0) {
+            for (const auto &factor : factors)
+                BigInteger::multiply_into(product, factor, product);
+        } else {
+            product = BigInteger::multiply_all(factors);
+        }
+
+        benchmark::DoNotOptimize(product);
+        benchmark::ClobberMemory();
+    }
+}
+
+BENCHMARK(BM_BigIntegerMultiplyAll)
+    ->ArgNames({"n", "tree"})->ArgsProduct({{10, 100, 1000}, {0, 1}})->Unit(benchmark::kMillisecond);
+
+// the sum of products in the frequency domain, against the products alone
+static void BM_BigDecimalDotProduct(benchmark::State &state) {
+    vector<BigDecimal> lhs, rhs;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        string x(10000, '0'), y(10000, '0');
+        generate_random_digits(x);
+        generate_random_digits(y);
+        lhs.emplace_back(x);
+        rhs.emplace_back(y);
+    }
+
+    MultiplyScratch scratch;
+    BigDecimal product;
+    for (auto _ : state) {
+        if (state.range(1) == 0) {
+            for (size_t i = 0; i < lhs.size(); ++i)
+                BigDecimal::multiply_into(lhs[i], rhs[i], product, scratch);
+        } else {
+            product = BigDecimal::dot_product(lhs, rhs);
+        }
+
+        benchmark::DoNotOptimize(product);
+        benchmark::ClobberMemory();
+    }
+}
+
+BENCHMARK(BM_BigDecimalDotProduct)
+    ->ArgNames({"n", "dot"})->ArgsProduct({{4, 16, 64}, {0, 1}})->Unit(benchmark::kMillisecond);
+
+// the multiplier has `range(0)` digits, and the multiplicand has `range(0) / range(1)` digits
+static void BM_BigIntegerMultiplyAsymmetric(benchmark::State &state) {
+    string x(state.range(0), '0'), y(state.range(0) / state.range(1), '0');
+    for (auto _ : state) {
+        state.PauseTiming();
+        generate_random_digits(x);
+        generate_random_digits(y);
+        BigInteger lhs(x), rhs(y);
+        state.ResumeTiming();
+
+        BigInteger result = lhs * rhs;
+
+        benchmark::DoNotOptimize(result);
+        benchmark::ClobberMemory();
+    }
+}
+
+BENCHMARK(BM_BigIntegerMultiplyAsymmetric)
+    ->ArgNames({"n", "ratio"})
+    ->ArgsProduct({{10000, 100000, 1000000}, {2, 10, 100, 1000}});
+
+static void BM_BigIntegerMultiplyNTT(benchmark::State &state) {
+    MultiplyEngine original = multiply_engine;
+    multiply_engine = MultiplyEngine::kNTT;
+
+    string x(state.range(0), '0');
+    for (auto _ : state) {
+        state.PauseTiming();
+        generate_random_digits(x);
+        BigInteger integer(x);
+        state.ResumeTiming();
+
+        BigInteger result = integer * integer;
+
+        benchmark::DoNotOptimize(result);
+        benchmark::ClobberMemory();
+    }
+    state.SetComplexityN(state.range(0));
+
+    multiply_engine = original;
+}
+
+BENCHMARK(BM_BigIntegerMultiplyNTT)
     ->RangeMultiplier(10)->Range(10, 1000000)->Complexity(benchmark::oNLogN);
 
+// scaling of the multiplication of huge numbers with the number of threads, the second argument.
+// it's measured in wall time, since the CPU time of the calling thread does not include the workers
+static void BM_BigIntegerMultiplyThreads(benchmark::State &state) {
+    set_thread_count(state.range(1));
+
+    string x(state.range(0), '0'), y(state.range(0), '0');
+    for (auto _ : state) {
+        state.PauseTiming();
+        generate_random_digits(x);
+        generate_random_digits(y);
+        BigInteger lhs(x), rhs(y);
+        state.ResumeTiming();
+
+        BigInteger result = lhs * rhs;
+
+        benchmark::DoNotOptimize(result);
+        benchmark::ClobberMemory();
+    }
+
+    set_thread_count(std::thread::hardware_concurrency());
+}
+
+BENCHMARK(BM_BigIntegerMultiplyThreads)
+    ->ArgsProduct({{1000000, 10000000}, {1, 2, 4, 8}})->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// the scientific notation only needs the first digits of the product, so the cost should follow the precision
+static void BM_BigDecimalMultiplySignificant(benchmark::State &state) {
+    string x(state.range(0), '0'), y(state.range(0), '0');
+    generate_random_digits(x);
+    generate_random_digits(y);
+    BigDecimal lhs(x), rhs(y);
+
+    for (auto _ : state) {
+        BigDecimal result = BigDecimal::multiply_significant(lhs, rhs, state.range(1));
+
+        benchmark::DoNotOptimize(result);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_BigDecimalMultiplySignificant)
+    ->ArgsProduct({{10000, 1000000}, {7, 51, 1000, 10000}})->Unit(benchmark::kMicrosecond);
+
+// used to find the crossovers between the multiplication algorithms (i.e. `kKaratsubaThreshold`):
+// every algorithm only performs one level of itself, then falls back to `balanced_multiply` for the sub-products,
+// so the first length where an algorithm wins is the threshold to switch to it
+static void BM_MultiplyAlgorithm(benchmark::State &state) {
+    const size_t n = state.range(1);
+    uniform_int_distribution<int64_t> distrib(0, kDigitRange - 1);
+    vector<int64_t> a(n), b(n), out(2 * n - 1), work(8 * n + balanced_workspace(n));
+    generate(a.begin(), a.end(), [&distrib]() { return distrib(rng); });
+    generate(b.begin(), b.end(), [&distrib]() { return distrib(rng); });
+
+    vector<uint16_t> lhs(a.begin(), a.end()), rhs(b.begin(), b.end()), result;
+    MultiplyScratch scratch;
+
+    for (auto _ : state) {
+        switch (state.range(0)) {
+            case 0:
+                schoolbook_multiply(a.data(), n, b.data(), n, out.data());
+                break;
+            case 1:
+                karatsuba_multiply(a.data(), b.data(), n, out.data(), work.data());
+                break;
+            case 2:
+                toom3_multiply(a.data(), b.data(), n, out.data(), work.data());
+                break;
+            default:
+                result.clear();
+                multiply_by_fft(lhs, rhs, result, scratch);
+                break;
+        }
+
+        benchmark::DoNotOptimize(out);
+        benchmark::DoNotOptimize(result);
+        benchmark::ClobberMemory();
+    }
+}
+
+BENCHMARK(BM_MultiplyAlgorithm)
+    ->ArgNames({"algorithm", "n"})
+    ->ArgsProduct({{0, 1}, {16, 24, 32, 40, 48, 64, 96}})
+    ->ArgsProduct({{1, 2}, {48, 64, 80, 96, 128, 192}})
+    ->ArgsProduct({{2, 3}, {128, 192, 256, 384, 512, 1024}});
+
 BENCHMARK_MAIN();
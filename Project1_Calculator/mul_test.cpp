@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include <complex>
+#include <iomanip>
 #include <random>
 
 #define main main2
@@ -11,6 +12,25 @@ using namespace std;
 static random_device rd;
 static mt19937 rng{rd()};
 
+// every heap allocation of the test binary is counted, so that the tests can check that nothing is allocated.
+// (not inlined, otherwise GCC warns that the memory of `new` is released by `free`)
+static std::atomic<size_t> allocations{0};
+
+__attribute__((noinline)) void *operator new(size_t size) {
+    ++allocations;
+    if (void *p = malloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
 static string remove_prefix(string s, char c) {
     s.erase(s.begin(), find_if(s.begin(), s.end(), [c](char ch) { return ch != c; }));
     return s;
@@ -46,6 +66,188 @@ TEST(FFTContextTest, IdentityTest) {
     }
 }
 
+TEST(FFTContextTest, SharedRootTableTest) {
+    constexpr int kSize = 16;
+    uniform_int_distribution<> distrib(0, 9999);
+
+    vector<complex<double>> original(kSize);
+    generate(original.begin(), original.end(), [&distrib]() { return distrib(rng); });
+
+    // DFT by definition: X[k] = sum x[j] * e^{2 pi i j k / n}
+    vector<complex<double>> expected(kSize);
+    for (int k = 0; k < kSize; k++)
+        for (int j = 0; j < kSize; j++)
+            expected[k] += original[j] * std::polar(1.0, 2 * M_PI * j * k / kSize);
+
+    const auto check = [&](const FFTContext &context) {
+        vector<complex<double>> data = original;
+        context.dft(data);
+        for (int k = 0; k < kSize; k++) {
+            EXPECT_NEAR(data[k].real(), expected[k].real(), 1e-6);
+            EXPECT_NEAR(data[k].imag(), expected[k].imag(), 1e-6);
+        }
+    };
+
+    // the short transform reads the table built for the long one with a stride
+    FFTContext long_context(1 << 12);
+    check(FFTContext(kSize));
+
+    // private tables are built when the cache is not allowed to hold them
+    FFTRootTable::set_memory_limit(0);
+    check(FFTContext(kSize));
+    FFTRootTable::set_memory_limit(std::numeric_limits<size_t>::max());
+}
+
+TEST(FFTContextTest, FourStepTest) {
+    constexpr uint32_t kSize = kFFTFourStepThreshold * 2;
+    uniform_int_distribution<> distrib(0, 9999);
+
+    vector<complex<double>> original(kSize);
+    generate(original.begin(), original.end(), [&distrib]() { return distrib(rng); });
+
+    FFTContext context(kSize);
+    vector<complex<double>> data = original;
+    context.dft(data);
+
+    // check some of the outputs by definition, the index is reduced first to keep the angle accurate
+    for (uint32_t k : {0U, 1U, 2U, 777U, kSize / 2 - 1, kSize / 2, kSize / 2 + 3, kSize - 1}) {
+        complex<double> expected;
+        for (uint32_t j = 0; j < kSize; j++)
+            expected += original[j] * std::polar(1.0, 2 * M_PI * static_cast<double>(uint64_t{j} * k % kSize) / kSize);
+        EXPECT_NEAR(data[k].real(), expected.real(), 1e-3);
+        EXPECT_NEAR(data[k].imag(), expected.imag(), 1e-3);
+    }
+
+    context.inverse_dft(data);
+    for (uint32_t i = 0; i < kSize; i++) {
+        EXPECT_NEAR(data[i].real(), original[i].real(), 1e-6);
+        EXPECT_NEAR(data[i].imag(), 0, 1e-6);
+    }
+}
+
+TEST(FFTContextTest, ThreadCountTest) {
+    constexpr uint32_t kSize = kFFTFourStepThreshold * 2;
+    uniform_int_distribution<> distrib(0, 9999);
+
+    vector<complex<double>> original(kSize);
+    generate(original.begin(), original.end(), [&distrib]() { return complex<double>(distrib(rng), distrib(rng)); });
+
+    const auto transform_with = [&](size_t threads) {
+        set_thread_count(threads);
+        vector<complex<double>> data = original;
+        FFTContext(kSize).dft(data);
+        return data;
+    };
+
+    // the result is bit-for-bit identical, no matter how many threads are used
+    vector<complex<double>> expected = transform_with(1);
+    for (size_t threads : {2, 3, 8})
+        EXPECT_TRUE(transform_with(threads) == expected);
+    set_thread_count(std::thread::hardware_concurrency());
+}
+
+TEST(FFTContextTest, NestedParallelForTest) {
+    // a task which starts another loop (like a product inside `batch_multiply`) runs the inner one sequentially
+    set_thread_count(4);
+    vector<std::atomic<int>> counts(8 * 8);
+    thread_pool().parallel_for(8, [&counts](size_t i) {
+        thread_pool().parallel_for(8, [&counts, i](size_t j) { counts[i * 8 + j]++; });
+    });
+    EXPECT_TRUE(std::all_of(counts.begin(), counts.end(), [](auto &count) { return count == 1; }));
+    set_thread_count(std::thread::hardware_concurrency());
+}
+
+TEST(FFTContextTest, KernelTest) {
+    uniform_int_distribution<> distrib(0, 9999);
+
+    // the SIMD kernel (if the CPU has it) agrees with the radix-2 one, both for powers of 4 and the others
+    for (uint32_t size = 4; size <= (1U << 14); size *= 2) {
+        vector<complex<double>> original(size);
+        generate(original.begin(), original.end(), [&]() { return complex<double>(distrib(rng), distrib(rng)); });
+
+        FFTContext context(size);
+        vector<complex<double>> data = original, expected = original;
+        context.dft(data);
+        fft_kernel = FFTKernel::kRadix2;
+        context.dft(expected);
+        fft_kernel = FFTKernel::kAuto;
+
+        for (uint32_t k = 0; k < size; k++) {
+            EXPECT_NEAR(data[k].real(), expected[k].real(), 1e-6 * size);
+            EXPECT_NEAR(data[k].imag(), expected[k].imag(), 1e-6 * size);
+        }
+
+        context.inverse_dft(data);
+        for (uint32_t i = 0; i < size; i++) {
+            EXPECT_NEAR(data[i].real(), original[i].real(), 1e-9);
+            EXPECT_NEAR(data[i].imag(), original[i].imag(), 1e-9);
+        }
+    }
+}
+
+TEST(NTTContextTest, IdentityTest) {
+    constexpr int kSize = 1024;
+    uniform_int_distribution<uint32_t> distrib(0, kNTTModulus1 - 1);
+
+    NTTContext1 context(kSize);
+    vector<uint32_t> original(context.n_);
+    generate(original.begin(), original.end(), [&distrib]() { return distrib(rng); });
+    vector<uint32_t> data = original;
+
+    context.dft(data);
+    context.inverse_dft(data);
+
+    EXPECT_EQ(data, original);
+}
+
+TEST(NTTContextTest, ChineseRemainderTest) {
+    // 10^25 + 12345678 (less than m1 * m2 * m3 ~ 5.9 * 10^25), in base 10^8 it is (100000000, 0, 0, 12345678)
+    const auto residue = [](uint32_t modulus) {
+        uint64_t value = 1;
+        for (int i = 0; i < 25; i++)
+            value = value * 10 % modulus;
+        return static_cast<uint32_t>((value + 12345678) % modulus);
+    };
+
+    uint64_t carry = 0;
+    EXPECT_EQ(chinese_remainder_carry(residue(kNTTModulus1), residue(kNTTModulus2), residue(kNTTModulus3),
+                                      kNTTPointRange, carry), 12345678U);
+    EXPECT_EQ(carry, 100000000000000000ULL);
+}
+
+TEST(PolynomialTest, BalancedTest) {
+    uniform_int_distribution<int64_t> distrib(0, 9999);
+
+    for (size_t n : {2, 3, 5, 6, 7, 16, 41, 99, 150, 151, 152, 500, 1001}) {
+        vector<int64_t> a(n), b(n), expected(2 * n - 1), karatsuba(2 * n - 1), toom3(2 * n - 1);
+        vector<int64_t> work(8 * n + balanced_workspace(n));  // one level of either, then `balanced_multiply`
+        generate(a.begin(), a.end(), [&distrib]() { return distrib(rng); });
+        generate(b.begin(), b.end(), [&distrib]() { return distrib(rng); });
+
+        schoolbook_multiply(a.data(), n, b.data(), n, expected.data());
+        karatsuba_multiply(a.data(), b.data(), n, karatsuba.data(), work.data());
+        EXPECT_EQ(karatsuba, expected);
+        if (n >= 5) {
+            toom3_multiply(a.data(), b.data(), n, toom3.data(), work.data());
+            EXPECT_EQ(toom3, expected);
+        }
+    }
+}
+
+TEST(PolynomialTest, UnbalancedTest) {
+    uniform_int_distribution<int64_t> distrib(0, 9999);
+
+    for (auto [n, m] : {pair{1, 1}, {1, 1000}, {100, 41}, {1000, 333}, {2000, 500}, {250, 3000}}) {
+        vector<int64_t> a(n), b(m), expected(n + m - 1), actual(n + m - 1), work(polynomial_workspace(n, m));
+        generate(a.begin(), a.end(), [&distrib]() { return distrib(rng); });
+        generate(b.begin(), b.end(), [&distrib]() { return distrib(rng); });
+
+        schoolbook_multiply(a.data(), n, b.data(), m, expected.data());
+        polynomial_multiply(a.data(), n, b.data(), m, actual.data(), work.data());
+        EXPECT_EQ(actual, expected);
+    }
+}
+
 TEST(BigIntegerTest, ParsingTest) {
     EXPECT_EQ(big_integer_string(BigInteger("1")), "+1");
     EXPECT_EQ(big_integer_string(BigInteger("-1")), "-1");
@@ -53,6 +255,31 @@ TEST(BigIntegerTest, ParsingTest) {
     EXPECT_EQ(big_integer_string(BigInteger("-00012345")), "-12345");
 }
 
+TEST(BigIntegerTest, ChunkedParsingTest) {
+    uniform_int_distribution<> digit_distrib('0', '9');
+
+    // every length and alignment goes through the 16-digit, 8-digit and the one-by-one paths
+    for (size_t n = 0; n < 70; n++) {
+        string x(n, '0');
+        generate(x.begin(), x.end(), [&]() { return static_cast<char>(digit_distrib(rng)); });
+        string expected = "+" + remove_prefix(x, '0');
+
+        EXPECT_EQ(big_integer_string(BigInteger(x)), expected);
+        for (size_t split = 0; split <= n; split++) {
+            string_view view = x;
+            EXPECT_EQ(big_integer_string(BigInteger(view.substr(0, split), view.substr(split))), expected);
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            for (char invalid : {'/', ':', ' ', '.', '\x80', '\0'}) {
+                string y = x;
+                y[i] = invalid;
+                EXPECT_THROW(BigInteger{y}, number_parse_error);
+            }
+        }
+    }
+}
+
 TEST(BigDecimalTest, ParsingTest) {
     EXPECT_EQ(big_decimal_string(BigDecimal("12345.6789")), "12345.6789");
     EXPECT_EQ(big_decimal_string(BigDecimal("0.0000000000000001")), "0.0000000000000001");
@@ -75,6 +302,12 @@ TEST(BigDecimalTest, InvalidInputTest) {
     EXPECT_THROW({ BigDecimal("1234e1000000000000000000000"); }, number_parse_error);
     EXPECT_THROW({ BigDecimal("12.34e11.11"); }, number_parse_error);
     EXPECT_THROW({ BigDecimal("中文"); }, number_parse_error);
+    EXPECT_THROW({ BigDecimal("1e+"); }, number_parse_error);
+    EXPECT_THROW({ BigDecimal("1e+-5"); }, number_parse_error);
+
+    // the exponent is not read past the end of the view
+    string_view view = "1e23";
+    EXPECT_EQ(big_decimal_string(BigDecimal(view.substr(0, 3))), "100");
 }
 
 TEST(BigDecimalTest, MultiplicationTest) {
@@ -85,3 +318,442 @@ TEST(BigDecimalTest, MultiplicationTest) {
     EXPECT_EQ(big_decimal_string(BigDecimal("-0") * BigDecimal("+0")), "0");
     EXPECT_EQ(big_decimal_string(BigDecimal("-0") * BigDecimal("1234.5")), "0");
 }
+
+TEST(BigDecimalTest, FormattingTest) {
+    uniform_int_distribution<> digit_distrib('0', '9');
+    uniform_int_distribution<> length_distrib(4, 80), exponent_distrib(-100, 100);
+
+    for (int round = 0; round < 2000; round++) {
+        // some zeros at both ends, so that the trimming is covered
+        string x(length_distrib(rng), '0');
+        generate(x.begin() + static_cast<ptrdiff_t>(rng() % 3), x.end() - static_cast<ptrdiff_t>(rng() % 3),
+                 [&]() { return static_cast<char>(digit_distrib(rng)); });
+        int64_t exponent = exponent_distrib(rng);
+        BigDecimal decimal(x + "e" + to_string(exponent));
+
+        // the significant digits `d`, and the value is 0.d * 10^point
+        string d = remove_prefix(x, '0');
+        int64_t point = static_cast<int64_t>(d.length()) + exponent;
+        d.erase(find_if(d.rbegin(), d.rend(), [](char c) { return c != '0'; }).base(), d.end());
+        if (d.empty()) {
+            EXPECT_EQ(big_decimal_string(decimal), "0");
+            continue;
+        }
+
+        string fixed;
+        if (point <= 0)
+            fixed = "0." + string(-point, '0') + d;
+        else if (point >= static_cast<int64_t>(d.length()))
+            fixed = d + string(point - d.length(), '0');
+        else
+            fixed = d.substr(0, point) + "." + d.substr(point);
+        EXPECT_EQ(big_decimal_string(decimal), fixed);
+
+        for (int precision : {0, 1, 3, 6, 100}) {
+            string scientific = d.substr(0, 1);
+            if (precision > 0 && d.length() > 1)
+                scientific += "." + d.substr(1, precision);
+            scientific += point >= 1 ? "e+" + to_string(point - 1) : "e-" + to_string(1 - point);
+
+            ostringstream ss;
+            ss << std::scientific << std::setprecision(precision) << decimal;
+            EXPECT_EQ(ss.str(), scientific);
+        }
+    }
+
+    // any slice of the digits can be written without building the whole string
+    BigInteger integer("12345678901234567890123456789012345678901234567890");
+    string digits = integer.get_number_string();
+    for (size_t first = 0; first <= digits.length(); first++) {
+        for (size_t count = 0; first + count <= digits.length(); count++) {
+            string slice(count, ' ');
+            integer.write_digits(first, count, slice.data());
+            EXPECT_EQ(slice, digits.substr(first, count));
+        }
+    }
+}
+
+TEST(BigDecimalTest, MultiplySignificantTest) {
+    uniform_int_distribution<> digit_distrib('0', '9'), nine_distrib(0, 9);
+    uniform_int_distribution<size_t> length_distrib(1, 3000), digits_distrib(1, 1200);
+
+    // the significant digits printed must be exactly those of the full product
+    auto check = [](const BigDecimal &lhs, const BigDecimal &rhs, size_t digits) {
+        const auto precision = static_cast<int64_t>(digits) - 1;
+        EXPECT_EQ(BigDecimal::multiply_significant(lhs, rhs, digits).format(true, precision),
+                  (lhs * rhs).format(true, precision));
+    };
+
+    for (int round = 0; round < 200; round++) {
+        // runs of 9s make the digits after the cut carry into the digits kept
+        const bool nines = nine_distrib(rng) < 3;
+        string x(length_distrib(rng), '9'), y(length_distrib(rng), '9');
+        if (!nines) {
+            generate(x.begin(), x.end(), [&]() { return static_cast<char>(digit_distrib(rng)); });
+            generate(y.begin(), y.end(), [&]() { return static_cast<char>(digit_distrib(rng)); });
+        }
+        check(BigDecimal("-" + x + "e-17"), BigDecimal(y + "e3"), digits_distrib(rng));
+    }
+
+    // (10^n - 1)(10^n + 1) = 10^2n - 1 has only 9s after the digits, so it falls back to the full product
+    for (size_t n : {100, 1000, 5000}) {
+        BigDecimal lhs(string(n, '9')), rhs("1" + string(n - 1, '0') + "1");
+        for (size_t digits : {1, 10, 99, 100, 101, 500})
+            check(lhs, rhs, digits);
+    }
+
+    check(BigDecimal("0"), BigDecimal("-12345"), 3);
+    // a zero operand with a long other one, whose lengths add up to more than the short product
+    const BigDecimal long_operand(string(60, '7'));
+    for (size_t digits : {1, 4, 100}) {
+        check(BigDecimal("0"), long_operand, digits);
+        check(long_operand, BigDecimal("-0e5"), digits);
+    }
+    check(BigDecimal("12345678e-3"), BigDecimal("87654321e+2"), 20);
+}
+
+TEST(BigIntegerTest, MultiplyIntoTest) {
+    BigInteger lhs("-123456789"), rhs("987654321987654321"), result("1");
+
+    BigInteger::multiply_into(lhs, rhs, result);
+    EXPECT_EQ(big_integer_string(result), "-121932631234567900112635269");
+
+    // the result is one of the operands
+    BigInteger::multiply_into(lhs, lhs, lhs);
+    EXPECT_EQ(big_integer_string(lhs), "+15241578750190521");
+    BigInteger::multiply_into(rhs, result, rhs);
+    EXPECT_EQ(big_integer_string(rhs), "-120427290230147841223861161238987959124847349");
+
+    BigInteger::multiply_into(BigInteger("0"), rhs, result);
+    EXPECT_EQ(result.number_string_length(), 0);
+
+    BigDecimal decimal("-1.5");
+    BigDecimal::multiply_into(decimal, BigDecimal("2.5e-3"), decimal);
+    EXPECT_EQ(big_decimal_string(decimal), "-0.00375");
+}
+
+TEST(BigIntegerTest, ScratchTest) {
+    uniform_int_distribution<> digit_distrib('0', '9');
+    const auto random_integer = [&digit_distrib](size_t n) {
+        string s(n, '0');
+        generate(s.begin(), s.end(), [&]() { return static_cast<char>(digit_distrib(rng)); });
+        return BigInteger(s);
+    };
+
+    // one multiplication of every tier, including squaring and NTT, and all of them share a scratch
+    const MultiplyEngine original = multiply_engine;
+    MultiplyScratch scratch;
+    for (auto [n, m, engine] : {tuple{20, 30, MultiplyEngine::kAuto}, {500, 700, MultiplyEngine::kAuto},
+                                {900, 4000, MultiplyEngine::kAuto}, {5000, 0, MultiplyEngine::kAuto},
+                                {40000, 2000, MultiplyEngine::kAuto},
+                                {5000, 6000, MultiplyEngine::kNTT}}) {
+        multiply_engine = engine;
+        BigInteger lhs = random_integer(n), rhs = m == 0 ? lhs : random_integer(m), result, expected;
+        BigInteger::multiply_into(lhs, rhs, expected);
+
+        // the first multiplication grows the scratch and `result`, then the same lengths allocate nothing
+        BigInteger::multiply_into(lhs, rhs, result, scratch);
+        EXPECT_EQ(big_integer_string(result), big_integer_string(expected));
+        const size_t before = allocations;
+        for (int i = 0; i < 3; ++i)
+            BigInteger::multiply_into(lhs, rhs, result, scratch);
+        EXPECT_EQ(allocations - before, 0) << "n = " << n << ", m = " << m;
+        EXPECT_EQ(big_integer_string(result), big_integer_string(expected));
+
+        // the result is one of the operands
+        BigInteger::multiply_into(lhs, rhs, lhs, scratch);
+        EXPECT_EQ(big_integer_string(lhs), big_integer_string(expected));
+    }
+    multiply_engine = original;
+}
+
+TEST(BigIntegerTest, StatsTest) {
+    if (!kStatsCompiled)
+        GTEST_SKIP();
+
+    const auto stat = [](const string &name) {
+        string report = multiply_stats.report();
+        size_t begin = report.find(name + ": ") + name.size() + 2;
+        return std::stod(report.substr(begin, report.find('\n', begin) - begin));
+    };
+
+    multiply_stats.reset();
+    stats_enabled = true;
+    BigInteger lhs(string(5000, '9')), rhs(string(3000, '7'));
+    BigInteger product = lhs * rhs;
+    stats_enabled = false;
+    BigInteger untracked = lhs * rhs;
+
+    EXPECT_EQ(stat("Multiplications"), 1);
+    EXPECT_EQ(stat("Transform length"), 2048);  // (1250 + 750) elements
+    EXPECT_GT(stat("Peak scratch size"), 0);
+    EXPECT_GT(stat("Max rounding error"), 0);
+    EXPECT_LT(stat("Max rounding error"), 0.1);
+    EXPECT_GT(stat("Transform") + stat("Inverse transform"), 0);
+
+    multiply_stats.reset();
+    EXPECT_EQ(stat("Multiplications"), 0);
+    EXPECT_EQ(stat("Max rounding error"), 0);
+}
+
+TEST(BigIntegerTest, FFTFallbackTest) {
+    BigInteger lhs(string(3000, '9')), rhs(string(2000, '9'));
+    const string expected = big_integer_string(lhs * rhs);
+    const uint64_t fallbacks = multiply_stats.fft_fallbacks();
+
+    // an FFT product always has some rounding error, so under a zero bound, they are all redone by NTT
+    const double original = fft_error_bound;
+    fft_error_bound = 0;
+    EXPECT_EQ(big_integer_string(lhs * rhs), expected);
+    EXPECT_EQ(big_integer_string(lhs * lhs), big_integer_string(BigInteger(string(2999, '9') + "8" +
+                                                                           string(2999, '0') + "1")));
+    EXPECT_EQ(big_integer_string(BigInteger("12") * BigInteger("34")), "+408");  // no FFT, no fallback
+    fft_error_bound = original;
+
+    EXPECT_EQ(multiply_stats.fft_fallbacks() - fallbacks, 2);
+}
+
+TEST(BigIntegerTest, MultiplyAllTest) {
+    EXPECT_EQ(big_integer_string(BigInteger::multiply_all({})), "+1");
+    EXPECT_EQ(big_integer_string(BigInteger::multiply_all({BigInteger("-42")})), "-42");
+
+    // 1000! by the product tree and by the chain, the factors grow from 1 to 4 digits, so the tree is unbalanced
+    vector<BigInteger> factors;
+    BigInteger chain("1");
+    for (int i = 1; i <= 1000; ++i) {
+        factors.emplace_back(std::to_string(i % 7 == 0 ? -i : i));
+        chain = chain * factors.back();
+    }
+    EXPECT_EQ(big_integer_string(BigInteger::multiply_all(factors)), big_integer_string(chain));
+
+    // long factors, so that the upper levels are transforms
+    uniform_int_distribution<> digit_distrib('0', '9');
+    factors.clear();
+    chain = BigInteger("1");
+    for (int i = 0; i < 9; ++i) {
+        string s(3000 + 100 * i, '0');
+        generate(s.begin(), s.end(), [&]() { return static_cast<char>(digit_distrib(rng)); });
+        factors.emplace_back(s);
+        chain = chain * factors.back();
+    }
+    EXPECT_EQ(big_integer_string(BigInteger::multiply_all(factors)), big_integer_string(chain));
+
+    EXPECT_EQ(big_decimal_string(BigDecimal::multiply_all({BigDecimal("1.5"), BigDecimal("-2e3"), BigDecimal(".01")})),
+              "-30");
+}
+
+TEST(BigDecimalTest, DotProductTest) {
+    EXPECT_EQ(big_decimal_string(BigDecimal::dot_product({}, {})), "0");
+    EXPECT_EQ(big_decimal_string(BigDecimal::dot_product({BigDecimal("1.5"), BigDecimal("2"), BigDecimal("0e99")},
+                                                         {BigDecimal("2e3"), BigDecimal("-.25"), BigDecimal("7")})),
+              "2999.5");
+    EXPECT_EQ(big_decimal_string(BigDecimal::dot_product({BigDecimal("1"), BigDecimal("1")},
+                                                         {BigDecimal("-1e-30"), BigDecimal("1e-30")})),
+              "0");
+    EXPECT_THROW(BigDecimal::dot_product({BigDecimal("1")}, {}), std::invalid_argument);
+
+    // x * y + x * (-y) + x * y * 10^-5 + x * y * 10^-5, the long pairs are summed in the frequency domain
+    uniform_int_distribution<> digit_distrib('0', '9');
+    const auto random_decimal = [&](size_t length, const string &suffix) {
+        string s(length, '0');
+        generate(s.begin(), s.end(), [&]() { return static_cast<char>(digit_distrib(rng)); });
+        return BigDecimal(s + suffix);
+    };
+    const BigDecimal x = random_decimal(5000, ""), y = random_decimal(3000, "e-2");
+    const vector<BigDecimal> lhs{x, x, x, BigDecimal("2e-5")};
+    const vector<BigDecimal> rhs{y, BigDecimal("-1") * y, BigDecimal("1e-5") * y, x * y};
+    const BigDecimal sum = BigDecimal::dot_product(lhs, rhs);
+    EXPECT_EQ(big_decimal_string(sum), big_decimal_string(BigDecimal("3e-5") * x * y));
+
+    // the same by the exact products, when every rounding error is too large
+    const double bound = fft_error_bound;
+    fft_error_bound = 0;
+    const BigDecimal exact = BigDecimal::dot_product(lhs, rhs);
+    fft_error_bound = bound;
+    EXPECT_EQ(big_decimal_string(exact), big_decimal_string(sum));
+
+    // a negative sum
+    EXPECT_EQ(big_decimal_string(BigDecimal::dot_product({x, x}, {y, BigDecimal("-2") * y})),
+              big_decimal_string(BigDecimal("-1") * x * y));
+}
+
+TEST(BigIntegerTest, EngineTest) {
+    const auto multiply_with = [](MultiplyEngine engine, const BigInteger &lhs, const BigInteger &rhs) {
+        MultiplyEngine original = multiply_engine;
+        multiply_engine = engine;
+        string result = big_integer_string(lhs * rhs);
+        multiply_engine = original;
+        return result;
+    };
+
+    // (10^n - 1)^2 = 99...9800...01, which has the largest possible elements
+    for (size_t n : {1, 4, 7, 8, 9, 1000, 12345}) {
+        BigInteger nines(string(n, '9'));
+        string expected = "+" + string(n - 1, '9') + "8" + string(n - 1, '0') + "1";
+        EXPECT_EQ(multiply_with(MultiplyEngine::kNTT, nines, nines), expected);
+        EXPECT_EQ(multiply_with(MultiplyEngine::kFFT, nines, nines), expected);
+    }
+
+    uniform_int_distribution<> digit_distrib('0', '9');
+    // 1500000 digits makes the transforms long enough for the four-step FFT
+    for (size_t n : {1, 2, 5, 31, 100, 999, 5000, 20000, 1500000}) {
+        string x(n, '0'), y(n / 2 + 1, '0');
+        generate(x.begin(), x.end(), [&]() { return static_cast<char>(digit_distrib(rng)); });
+        generate(y.begin(), y.end(), [&]() { return static_cast<char>(digit_distrib(rng)); });
+        y[0] = '-';
+
+        BigInteger lhs(x), rhs(y);
+        EXPECT_EQ(multiply_with(MultiplyEngine::kNTT, lhs, rhs), multiply_with(MultiplyEngine::kFFT, lhs, rhs));
+    }
+}
+
+TEST(BigIntegerTest, OutOfCoreNTTTest) {
+    uniform_int_distribution<> digit_distrib('0', '9');
+    const auto random_digits = [&](size_t n) {
+        string x(n, '0');
+        generate(x.begin(), x.end(), [&]() { return static_cast<char>(digit_distrib(rng)); });
+        x[0] = '9';
+        return x;
+    };
+    const auto multiply_with = [](size_t memory_limit, const BigInteger &lhs, const BigInteger &rhs) {
+        MultiplyEngine original = multiply_engine;
+        multiply_engine = MultiplyEngine::kNTT;
+        transform_memory_limit = memory_limit;
+        string result = big_integer_string(lhs * rhs);
+        multiply_engine = original;
+        transform_memory_limit = std::numeric_limits<size_t>::max();
+        return result;
+    };
+
+    // under the smallest limit, only a row or a column of the matrix is in memory at a time
+    for (auto [n, m] : vector<pair<size_t, size_t>>{{1, 1}, {9, 20000}, {40000, 40000}, {123457, 30001}, {200000, 17}}) {
+        BigInteger lhs(random_digits(n)), rhs(random_digits(m));
+        EXPECT_EQ(multiply_with(0, lhs, rhs), multiply_with(std::numeric_limits<size_t>::max(), lhs, rhs));
+    }
+
+    // the largest possible elements
+    BigInteger nines(string(100000, '9'));
+    EXPECT_EQ(multiply_with(0, nines, nines), "+" + string(99999, '9') + "8" + string(99999, '0') + "1");
+
+    // the size check spills the transforms only if they exceed the limit
+    BigInteger lhs(random_digits(70000)), rhs(random_digits(50000));
+    const size_t workspace = ntt_workspace((17500 + 1) / 2 + (12500 + 1) / 2);
+    const string expected = multiply_with(std::numeric_limits<size_t>::max(), lhs, rhs);
+    uint64_t spilled = multiply_stats.spilled_products();
+    EXPECT_EQ(multiply_with(workspace, lhs, rhs), expected);
+    EXPECT_EQ(multiply_stats.spilled_products(), spilled);
+    EXPECT_EQ(multiply_with(workspace - 1, lhs, rhs), expected);
+    EXPECT_EQ(multiply_stats.spilled_products(), spilled + 1);
+
+    // longer than the transforms, the operands are cut into blocks, and the products of the pairs are summed
+    uniform_int_distribution<int> element_distrib(0, kDigitRange - 1);
+    const auto random_elements = [&](size_t n) {
+        vector<uint16_t> elements(n);
+        generate(elements.begin(), elements.end(), [&]() { return static_cast<uint16_t>(element_distrib(rng)); });
+        return elements;
+    };
+    const auto trimmed = [](vector<uint16_t> elements) {
+        while (!elements.empty() && elements.back() == 0)
+            elements.pop_back();
+        return elements;
+    };
+    for (auto [n, m] : vector<pair<size_t, size_t>>{{7500, 7500}, {25000, 2}, {3001, 16999}}) {
+        vector<uint16_t> lhs_elements = random_elements(n), rhs_elements = random_elements(m), blocked, whole;
+        multiply_by_out_of_core_ntt(lhs_elements, rhs_elements, blocked, 0, 1U << 12);
+        multiply_by_out_of_core_ntt(lhs_elements, rhs_elements, whole, 0);
+        EXPECT_EQ(trimmed(blocked), trimmed(whole));
+    }
+}
+
+TEST(BigIntegerTest, UnbalancedTest) {
+    uniform_int_distribution<> digit_distrib('0', '9');
+    const auto random_integer = [&digit_distrib](size_t n) {
+        string s(n, '0');
+        generate(s.begin(), s.end(), [&]() { return static_cast<char>(digit_distrib(rng)); });
+        return BigInteger(s);
+    };
+    const auto multiply_with = [](MultiplyEngine engine, const BigInteger &lhs, const BigInteger &rhs) {
+        MultiplyEngine original = multiply_engine;
+        multiply_engine = engine;
+        string result = big_integer_string(lhs * rhs);
+        multiply_engine = original;
+        return result;
+    };
+
+    // the long operand ends in the first or the second block of a pair, or exactly at the end of a block (with the
+    // short operand of 300 elements, a transform has 1024 points, and a block has 725 elements)
+    for (auto [n, m] : {pair{1200, 20000}, {1200, 1200 * 8}, {40000, 2000}, {1200, 4 * 725 * 4}, {1200, 5 * 725 * 4},
+                        {1200, 3 * 725 * 4 + 1}}) {
+        BigInteger lhs = random_integer(n), rhs = random_integer(m);
+        EXPECT_EQ(multiply_with(MultiplyEngine::kAuto, lhs, rhs), multiply_with(MultiplyEngine::kNTT, lhs, rhs))
+                << "n = " << n << ", m = " << m;
+    }
+
+    // the largest elements
+    BigInteger nines(string(100000, '9')), short_nines(string(2000, '9'));
+    string expected = "+" + string(1999, '9') + "8" + string(98000, '9') + string(1999, '0') + "1";
+    EXPECT_EQ(big_integer_string(nines * short_nines), expected);
+}
+
+TEST(BigIntegerTest, TieredMultiplicationTest) {
+    uniform_int_distribution<> digit_distrib('0', '9');
+    const auto random_integer = [&digit_distrib](size_t n) {
+        string s(n, '0');
+        generate(s.begin(), s.end(), [&]() { return static_cast<char>(digit_distrib(rng)); });
+        return BigInteger(s);
+    };
+
+    // cover every tier, and unbalanced operands across the tiers
+    for (auto [n, m] : {pair{1, 1}, {3, 200}, {100, 100}, {159, 160}, {600, 601}, {2000, 2001}, {3000, 7},
+                        {4000, 900}, {10000, 10000}}) {
+        BigInteger lhs = random_integer(n), rhs = random_integer(m);
+
+        MultiplyEngine original = multiply_engine;
+        multiply_engine = MultiplyEngine::kNTT;
+        string expected = big_integer_string(lhs * rhs);
+        multiply_engine = original;
+
+        EXPECT_EQ(big_integer_string(lhs * rhs), expected);
+    }
+}
+
+TEST(BigIntegerTest, LimbPolicyTest) {
+    // packing and unpacking round-trip for every length of the last group
+    uniform_int_distribution<> element_distrib(0, kDigitRange - 1);
+    for (size_t n = 0; n <= 2 * Limb32::kGroupElements; ++n) {
+        vector<uint16_t> elements(n), unpacked;
+        generate(elements.begin(), elements.end(), [&]() { return static_cast<uint16_t>(element_distrib(rng)); });
+        vector<uint32_t> limbs(Limb32::limbs(n));
+        Limb32::pack(elements, limbs.data());
+        EXPECT_TRUE(all_of(limbs.begin(), limbs.end(), [](uint32_t limb) { return limb < Limb32::kBase; }));
+
+        Limb32::unpack(limbs.data(), limbs.size(), unpacked);
+        ASSERT_GE(unpacked.size(), n);
+        EXPECT_TRUE(all_of(unpacked.begin() + static_cast<ptrdiff_t>(n), unpacked.end(),
+                           [](uint16_t element) { return element == 0; }));
+        unpacked.resize(n);
+        EXPECT_EQ(unpacked, elements);
+    }
+
+    // the same products on both policies, across the schoolbook and NTT tiers, with random digits and all 9s
+    uniform_int_distribution<> digit_distrib('0', '9');
+    for (auto [n, m] : {pair{1, 1}, {60, 70}, {63, 5000}, {500, 1000}, {1000, 1001}, {4000, 900}, {20000, 20000}}) {
+        for (bool nines : {false, true}) {
+            string x(n, '9'), y(m, '9');
+            if (!nines) {
+                generate(x.begin(), x.end(), [&]() { return static_cast<char>(digit_distrib(rng)); });
+                generate(y.begin(), y.end(), [&]() { return static_cast<char>(digit_distrib(rng)); });
+            }
+            BigInteger lhs(x), rhs("-" + y);
+
+            for (MultiplyEngine engine : {MultiplyEngine::kAuto, MultiplyEngine::kNTT}) {
+                multiply_engine = engine;
+                limb_policy = LimbPolicy::kElement;
+                string expected = big_integer_string(lhs * rhs);
+                limb_policy = LimbPolicy::kWide;
+                EXPECT_EQ(big_integer_string(lhs * rhs), expected);
+            }
+            multiply_engine = MultiplyEngine::kAuto;
+        }
+    }
+}
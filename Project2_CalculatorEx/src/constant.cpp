@@ -1,8 +1,5 @@
 #include "constant.h"
 
 const BigDecimal BIG_DECIMAL_ZERO = BigDecimal("0");
-const BigDecimal BIG_DECIMAL_ZERO_TWO = BigDecimal("0.2");
 const BigDecimal BIG_DECIMAL_HALF = BigDecimal("0.5");
 const BigDecimal BIG_DECIMAL_ONE = BigDecimal("1");
-const BigDecimal BIG_DECIMAL_THREEHALFS = BigDecimal("1.5");
-const BigDecimal BIG_DECIMAL_TWO = BigDecimal("2");
@@ -4,14 +4,13 @@
 #include "number.h"
 
 constexpr size_t kExtraScale = 7;
+constexpr size_t kSeedDigits = 14;  // the correct digits of the initial values of Newton's iterations, from `double`
+constexpr size_t kGuardDigits = 4;  // the extra digits every step of the iterations keeps beyond the ones it needs
 constexpr int64_t kWarningDepth = 5000;
 constexpr int64_t kDivergentLimit = 500000;
 
-extern const BigDecimal BIG_DECIMAL_ZERO;        // 0
-extern const BigDecimal BIG_DECIMAL_ZERO_TWO;    // 0.2
-extern const BigDecimal BIG_DECIMAL_HALF;        // 0.5
-extern const BigDecimal BIG_DECIMAL_ONE;         // 1
-extern const BigDecimal BIG_DECIMAL_THREEHALFS;  // 1.5
-extern const BigDecimal BIG_DECIMAL_TWO;         // 2
+extern const BigDecimal BIG_DECIMAL_ZERO;  // 0
+extern const BigDecimal BIG_DECIMAL_HALF;  // 0.5
+extern const BigDecimal BIG_DECIMAL_ONE;   // 1
 
 #endif  // CALCULATOR_SRC_CONSTANT_H
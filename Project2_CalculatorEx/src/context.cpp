@@ -203,6 +203,6 @@ void load_builtin_context(Context &context) {
     }));
 
     context.insert("e", Entry::lazy_variable([](Context &ctx) {
-        return exp(BIG_DECIMAL_ONE, ctx.scale());
+        return euler_number(ctx.scale());
     }));
 }
@@ -1,43 +1,20 @@
 #include <algorithm>
+#include <cmath>
+#include <functional>
 #include <iostream>
 #include <utility>
+#include <vector>
 
 #include "constant.h"
 #include "error.h"
 #include "eval.h"
 
 using std::function;
+using std::max;
 using std::min;
+using std::pair;
 using std::to_string;
-
-bool should_newtons_end(const BigDecimal &lhs, const BigDecimal &rhs, const size_t scale) {
-    if (lhs.exponent() != rhs.exponent() || lhs.mantissa().digits().size() != rhs.mantissa().digits().size())
-        return false;
-
-    // since sometimes the x will jitter in the last digit
-    // so, we just compare them without caring about the last digit
-    size_t len = min(lhs.mantissa().digits().size(), 1UL);
-
-    // however, if the last digit is not at the end of scale (like number "2" and "3"), then do not ignore
-    if (-lhs.exponent() <= static_cast<int64_t>(scale))
-        len = 0;
-
-    return equal(lhs.mantissa().digits().begin() + len, lhs.mantissa().digits().end(),
-                 rhs.mantissa().digits().begin() + len, rhs.mantissa().digits().end());
-}
-
-BigDecimal newtons_method(const function<BigDecimal(const BigDecimal&)>& formula,
-                          BigDecimal initial, const size_t scale) {
-    BigDecimal x = std::move(initial);
-    while (true) {
-        BigDecimal y = formula(x);
-        y.round_by_scale(scale + kExtraScale);
-        if (should_newtons_end(x, y, scale))
-            break;
-        x = std::move(y);
-    }
-    return x;
-}
+using std::vector;
 
 BigDecimal pow(BigDecimal x, BigDecimal y, const size_t required_scale) {
     size_t scale = required_scale + kExtraScale;
@@ -45,8 +22,9 @@ BigDecimal pow(BigDecimal x, BigDecimal y, const size_t required_scale) {
 
     y.drop_decimal();
     while (!y.is_zero()) {
-        // check the units digit is available (otherwise it means 0) and it's odd
-        if (y.exponent() == 0 && y.mantissa().digits()[0] % 2 == 1)
+        // check the units digit is available (otherwise it means 0) and it's odd, the base of the limbs is even, so
+        // the lowest limb has the same parity
+        if (y.exponent() == 0 && y.mantissa().limbs()[0] % 2 == 1)
             result = result * x;
         x = x * x;
         x.round_by_scale(scale);
@@ -59,148 +37,479 @@ BigDecimal pow(BigDecimal x, BigDecimal y, const size_t required_scale) {
     return result;
 }
 
+// 1 / sqrt(x) to `length` significant digits, by Newton's iteration y <- y + y * (1 - x * y^2) / 2, which doubles the
+// correct digits of y every step. like the reciprocal of `div_with_scale`, every step rounds x and y to only twice
+// the digits of the previous one, so the whole iteration costs a few multiplications of the last length
+BigDecimal rsqrt(const BigDecimal &x, const size_t length) {
+    // the initial value from x = v * 10^2k, where v = 0.d1d2d3... or d1.d2d3..., as 1/sqrt(x) = 1/sqrt(v) * 10^-k
+    int64_t exponent = x.most_significant_exponent();
+    double v = x.leading_value();
+    if (exponent % 2 != 0) {
+        v *= 10;
+        exponent -= 1;
+    }
+    BigDecimal y(BigInteger(to_string(llround(1e15 / std::sqrt(v)))), -15 - exponent / 2, true);
+
+    for (size_t correct = kSeedDigits; correct < length;) {
+        const size_t next = min(2 * correct - 1, length);
+
+        // 1 - x * y^2 is about 10^-correct, so its leading `next - correct` digits are enough
+        BigDecimal square = rounded_to_significant(y * y, next + kGuardDigits);
+        BigDecimal error = BIG_DECIMAL_ONE - rounded_to_significant(x, next + kGuardDigits) * square;
+        BigDecimal delta = y * rounded_to_significant(error * BIG_DECIMAL_HALF, next - correct + kGuardDigits);
+        y = rounded_to_significant(y + rounded_to_significant(delta, next - correct + kGuardDigits),
+                                   next + kGuardDigits);
+        correct = next;
+    }
+    return y;
+}
+
+// sqrt(x) = x * (1 / sqrt(x)), without any division. the inverse square root y only needs half of the digits:
+//     s0 = x * y, which is correct to half of the digits
+//     s = s0 + y * (x - s0^2) / 2
+// the remainder is tiny, so its product with the half-length y corrects the other half (Karp-Markstein)
 BigDecimal sqrt(const BigDecimal &x, const size_t scale) {
     if (x.is_zero())
         return BIG_DECIMAL_ZERO;
     if (x < BIG_DECIMAL_ZERO)
         throw runtime_error("try to sqrt a negative number");
 
-    size_t inv_scale = x.most_significant_exponent() + scale;
-    BigDecimal half_x = x * BIG_DECIMAL_HALF;
-    BigDecimal initial = BigDecimal(BigInteger({1}), - (x.most_significant_exponent() + 1) / 2, true);
+    // x < 10^e, so sqrt(x) < 10^ceil(e/2), and it needs that many integer digits and `scale` decimal digits
+    const int64_t exponent = x.most_significant_exponent();
+    const int64_t integer_digits = exponent >= 0 ? (exponent + 1) / 2 : exponent / 2;
+    const auto length = static_cast<size_t>(max<int64_t>(integer_digits + static_cast<int64_t>(scale + kExtraScale),
+                                                         1)) + kGuardDigits;
+    const size_t half = length / 2 + kGuardDigits;
+
+    const BigDecimal shortened = rounded_to_significant(x, length + kGuardDigits);
+    const BigDecimal inv_sqrt = rsqrt(shortened, half);
+    BigDecimal result = rounded_to_significant(shortened * inv_sqrt, half);
+    BigDecimal remainder = rounded_to_significant(shortened - result * result, half);
+    result = result + rounded_to_significant(inv_sqrt * remainder * BIG_DECIMAL_HALF, half);
+    result.round_by_scale(scale);
+    return result;
+}
 
-    // y <- y * (3/2 - (x/2) * y^2)
-    BigDecimal inv_sqrt = newtons_method([&half_x](auto &y) { return y * (BIG_DECIMAL_THREEHALFS - half_x * y * y); },
-                                         std::move(initial), inv_scale);
+// the partial results of binary splitting over the terms [a, b) of a series 1 + r(1) + r(1)r(2) + ...:
+//     p = r(a)...r(b-1) without the denominators, q = the denominators of r(a)...r(b-1)
+//     t / q = r(a) + r(a)r(a+1) + ... + r(a)...r(b-1)
+struct SeriesSplit {
+    BigDecimal p, q, t;
+};
 
-    BigDecimal result = BIG_DECIMAL_ONE.div_with_scale(inv_sqrt, scale + kExtraScale);
+// the terms [a, c) from the terms [a, b) and [b, c)
+SeriesSplit merge_splits(const SeriesSplit &left, const SeriesSplit &right) {
+    return {left.p * right.p, left.q * right.q, left.t * right.q + left.p * right.t};
+}
 
-    // do an extra Newton's Iteration
-    result = BIG_DECIMAL_HALF * (result + x.div_with_scale(result, scale + kExtraScale));
-    result.round_by_scale(scale);
-    return result;
+// every numerator is `z * numerator(k)`, so `p` and `t` are exact products of `z` and integers. the halves are merged
+// by a few multiplications of about the same length, so the whole series costs a few multiplications of its total
+// length, rather than a multiplication and a division of the full length for every term
+SeriesSplit split_series(const BigDecimal &z, const function<uint64_t(uint64_t)> &numerator,
+                         const function<uint64_t(uint64_t)> &denominator, const uint64_t a, const uint64_t b) {
+    if (b - a == 1) {
+        BigDecimal p = z.simple_mul(numerator(a), 0);
+        return {p, BIG_DECIMAL_ONE.simple_mul(denominator(a), 0), p};
+    }
+
+    const uint64_t middle = a + (b - a) / 2;
+    return merge_splits(split_series(z, numerator, denominator, a, middle),
+                        split_series(z, numerator, denominator, middle, b));
 }
 
-BigDecimal trigonometric_functions_taylor(const BigDecimal &x2, BigDecimal first, uint64_t k, const size_t scale) {
-    BigDecimal result = BIG_DECIMAL_ZERO;
-    BigDecimal term = std::move(first);
-    while (!term.is_zero()) {
-        result = result + term;
-        term = (term * x2).simple_div_with_scale(k * (k + 1), scale + kExtraScale);
-        k += 2;
+// the terms [0, count) of the series below, for a long z, whose exact powers in binary splitting get longer and
+// longer. the terms are summed backwards by Horner's rule, where only every m-th step multiplies by z^m, and the other
+// steps add z^j from a table of z^0, ..., z^(m-1) and multiply by the small integers of r(k) (the "rectangular
+// splitting"), so it's about 2 sqrt(count) multiplications of `scale` digits
+BigDecimal sum_series_by_rectangles(const BigDecimal &z, const function<uint64_t(uint64_t)> &numerator,
+                                    const function<uint64_t(uint64_t)> &denominator, const uint64_t count,
+                                    const size_t scale) {
+    const auto m = static_cast<uint64_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+    vector<BigDecimal> powers{BIG_DECIMAL_ONE};
+    for (uint64_t j = 1; j <= m; j++) {
+        powers.push_back(powers.back() * z);
+        powers.back().round_by_scale(scale);
     }
-    result.round_by_scale(scale);
-    return result;
+
+    // after the step n, `sum` is the terms [n, count) divided by the term n, and multiplied by z^(n mod m)
+    BigDecimal sum = BIG_DECIMAL_ZERO;
+    for (uint64_t n = count; n-- > 0;) {
+        if (n + 1 < count) {
+            if ((n + 1) % m == 0) {
+                sum = sum * powers[m];
+                sum.round_by_scale(scale);
+            }
+            sum = sum.simple_mul(numerator(n + 1), 0).simple_div_with_scale(denominator(n + 1), scale);
+        }
+        sum = sum + powers[n % m];
+    }
+    return sum;
+}
+
+// 1 + r(1) + r(1)r(2) + ... to `scale` decimal digits, with r(k) = z * numerator(k) / denominator(k), by binary
+// splitting, or by rectangular splitting if z is long. the number of terms is estimated from the magnitude of r(k), as
+// `double`
+BigDecimal sum_series(const BigDecimal &z, const function<uint64_t(uint64_t)> &numerator,
+                      const function<uint64_t(uint64_t)> &denominator, const size_t scale) {
+    if (z.is_zero())
+        return BIG_DECIMAL_ONE;
+
+    // stop at the first term which is below 10^-scale, and where the terms decrease quickly, so the rest is smaller.
+    // the largest term and the largest r(1)...r(k) bound how much the rounding errors of the rectangles grow
+    const double log_z = static_cast<double>(z.most_significant_exponent()) + std::log10(z.leading_value());
+    const double target = -static_cast<double>(scale + kGuardDigits);
+    double log_term = 0, log_coefficient = 0, log_growth = 0;
+    uint64_t count = 1;
+    while (true) {
+        const double log_ratio = log_z + std::log10(static_cast<double>(numerator(count)))
+                - std::log10(static_cast<double>(denominator(count)));
+        log_term += log_ratio;
+        log_coefficient += log_ratio - log_z;
+        log_growth = max({log_growth, log_term, log_coefficient});
+        if (log_term < target && log_ratio < -0.3)
+            break;
+        count++;
+    }
+    if (count == 1)
+        return BIG_DECIMAL_ONE;
+
+    // binary splitting ends with z^(count - 1) in full, which is far longer than `scale` if z is long
+    const double power_digits = static_cast<double>(count) * static_cast<double>(z.mantissa().digit_count());
+    if (power_digits > 8.0 * static_cast<double>(scale)) {
+        const size_t extended = scale + kGuardDigits + static_cast<size_t>(std::ceil(log_growth))
+                + to_string(count).size();
+        BigDecimal result = sum_series_by_rectangles(z, numerator, denominator, count, extended);
+        result.round_by_scale(scale);
+        return result;
+    }
+
+    SeriesSplit split = split_series(z, numerator, denominator, 1, count);
+    return BIG_DECIMAL_ONE + split.t.div_with_scale(split.q, scale);
+}
+
+// x with the digits below 10^-scale dropped
+BigDecimal truncated_by_scale(const BigDecimal &x, const size_t scale) {
+    BigDecimal shifted(BigInteger(x.mantissa()), x.exponent() + static_cast<int64_t>(scale), x.positive());
+    shifted.drop_decimal();
+    return BigDecimal(BigInteger(shifted.mantissa()), shifted.exponent() - static_cast<int64_t>(scale),
+                      shifted.positive());
+}
+
+// the series converge fast only for short arguments, so a long one is summed piece by piece, where the digits of the
+// pieces are [1, kBurstDigits], (kBurstDigits, 2 * kBurstDigits], ... every piece is small compared to its length,
+// so its series needs fewer terms as its length grows, and each piece costs about the same (the "bit-burst")
+constexpr size_t kBurstDigits = 2;
+
+// x = sum of the returned pieces, where x has at most `scale` decimal digits
+vector<BigDecimal> burst_pieces(const BigDecimal &x, const size_t scale) {
+    vector<BigDecimal> pieces;
+    BigDecimal previous = BIG_DECIMAL_ZERO;
+    for (size_t digits = kBurstDigits; ; digits *= 2) {
+        BigDecimal current = digits >= scale ? x : truncated_by_scale(x, digits);
+        if (current != previous)
+            pieces.push_back(current - previous);
+        if (digits >= scale)
+            break;
+        previous = std::move(current);
+    }
+    return pieces;
+}
+
+constexpr double kLog10E = 0.43429448190325182765;  // log10[e]
+
+// an approximation of x, which must not be too large
+double to_double(const BigDecimal &x) {
+    const double value = x.leading_value() * std::pow(10.0, static_cast<double>(x.most_significant_exponent()));
+    return x.positive() ? value : -value;
+}
+
+// x / 2^k, for the least k that |x / 2^k| < 1
+BigDecimal halved_below_one(BigDecimal x, size_t &halvings) {
+    halvings = 0;
+    while (!x.is_zero() && x.most_significant_exponent() > 0) {
+        x = x * BIG_DECIMAL_HALF;
+        halvings++;
+    }
+    return x;
+}
+
+// (sin[x], cos[x]), by halving x to below 1, summing both series of every piece, merging the pieces by
+//     sin[a + b] = sin[a]cos[b] + cos[a]sin[b], cos[a + b] = cos[a]cos[b] - sin[a]sin[b]
+// and doubling back by sin[2x] = 2sin[x]cos[x], cos[2x] = cos[x]^2 - sin[x]^2
+pair<BigDecimal, BigDecimal> sin_cos(const BigDecimal &x, const size_t required_scale) {
+    size_t halvings;
+    BigDecimal y = halved_below_one(x, halvings);
+
+    // every doubling at most quadruples the error
+    const size_t scale = required_scale + kExtraScale + kGuardDigits + halvings;
+    y.round_by_scale(scale);
+
+    BigDecimal sin_y = BIG_DECIMAL_ZERO, cos_y = BIG_DECIMAL_ONE;
+    for (const BigDecimal &piece : burst_pieces(y, scale)) {
+        // sin[x] = x - x^3/3! + x^5/5! - ..., and cos[x] = sqrt[1 - sin[x]^2], as |x| < 1 < pi/2
+        BigDecimal sin_piece = piece * sum_series(- piece * piece, [](auto) { return 1; },
+                                                  [](auto k) { return 2 * k * (2 * k + 1); }, scale);
+        BigDecimal cos_piece = sqrt(BIG_DECIMAL_ONE - sin_piece * sin_piece, scale);
+
+        BigDecimal next_sin = sin_y * cos_piece + cos_y * sin_piece;
+        cos_y = cos_y * cos_piece - sin_y * sin_piece;
+        sin_y = std::move(next_sin);
+        sin_y.round_by_scale(scale);
+        cos_y.round_by_scale(scale);
+    }
+
+    for (size_t i = 0; i < halvings; i++) {
+        BigDecimal next_sin = (sin_y * cos_y).simple_mul(2, 0);
+        cos_y = (cos_y - sin_y) * (cos_y + sin_y);
+        sin_y = std::move(next_sin);
+        sin_y.round_by_scale(scale);
+        cos_y.round_by_scale(scale);
+    }
+
+    sin_y.round_by_scale(required_scale);
+    cos_y.round_by_scale(required_scale);
+    return {sin_y, cos_y};
 }
 
-// sin[x] = x - x^3/6 + x^5/120 - ...
 BigDecimal sin(const BigDecimal &x, const size_t scale) {
-    return trigonometric_functions_taylor(- x * x, x, 2, scale);
+    return sin_cos(x, scale).first;
 }
 
-// cos[x] = 1 - x^2/2 + x^4/24 - ...
 BigDecimal cos(const BigDecimal &x, const size_t scale) {
-    return trigonometric_functions_taylor(- x * x, BIG_DECIMAL_ONE, 1, scale);
+    return sin_cos(x, scale).second;
 }
 
-// arctan[x] = arctan[c] + arctan[(x-c)/(1+cx)], for small c (here c = 0.2)
-// formula: arctan[x] = x - x^3/3 + x^5/5 - ...
+// arctan[x] = x - x^3/3 + x^5/5 - ..., or artanh[x] = x + x^3/3 + x^5/5 + ... if `hyperbolic`, for a short x
+BigDecimal arctan_series(const BigDecimal &x, const size_t scale, const bool hyperbolic) {
+    const BigDecimal square = x * x;
+    return x * sum_series(hyperbolic ? square : -square, [](auto k) { return 2 * k - 1; },
+                          [](auto k) { return 2 * k + 1; }, scale);
+}
+
+// arctan[x] (or artanh[x]) of a small x, summed piece by piece by
+//     arctan[x] = arctan[c] + arctan[(x - c) / (1 + cx)], artanh[x] = artanh[c] + artanh[(x - c) / (1 - cx)]
+// where c is the leading digits of x
+BigDecimal arctan_by_pieces(BigDecimal x, const size_t scale, const bool hyperbolic) {
+    x.round_by_scale(scale);
+
+    BigDecimal result = BIG_DECIMAL_ZERO;
+    for (size_t digits = kBurstDigits; !x.is_zero(); digits *= 2) {
+        const BigDecimal leading = digits >= scale ? x : truncated_by_scale(x, digits);
+        result = result + arctan_series(leading, scale, hyperbolic);
+        if (digits >= scale)
+            break;
+        const BigDecimal product = x * leading;
+        x = (x - leading).div_with_scale(hyperbolic ? BIG_DECIMAL_ONE - product : BIG_DECIMAL_ONE + product, scale);
+    }
+    return result;
+}
+
+// the argument is halved by arctan[x] = 2 * arctan[x / (1 + sqrt[1 + x^2])] to below 1/2, and then summed piece by
+// piece
 BigDecimal arctan(BigDecimal x, const size_t required_scale) {
     if (x < BIG_DECIMAL_ZERO)
         return -arctan(-x, required_scale);
 
-    size_t scale = required_scale + kExtraScale;
-    BigDecimal arctan_02 = BIG_DECIMAL_ZERO;
-    size_t f = 0;
-
-    if (x > BIG_DECIMAL_ZERO_TWO) {
-        arctan_02 = arctan(BIG_DECIMAL_ZERO_TWO, scale);
-        while (x > BIG_DECIMAL_ZERO_TWO) {
-            f++;
-            x = (x - BIG_DECIMAL_ZERO_TWO).div_with_scale(BIG_DECIMAL_ONE + x * BIG_DECIMAL_ZERO_TWO, scale);
-        }
+    // at most 2 halvings are needed, since the first one makes x <= 1, so the guard digits cover them
+    const size_t scale = required_scale + kExtraScale + kGuardDigits;
+    size_t halvings = 0;
+    while (x > BIG_DECIMAL_HALF) {
+        x = x.div_with_scale(BIG_DECIMAL_ONE + sqrt(BIG_DECIMAL_ONE + x * x, scale), scale);
+        halvings++;
     }
-    arctan_02 = arctan_02.simple_mul(f, 0);
 
-    BigDecimal result = BIG_DECIMAL_ZERO;
-    BigDecimal x_square = - x * x;
-    BigDecimal term = x;
-    uint64_t k = 1;
-    while (!term.is_zero()) {
-        result = result + term.simple_div_with_scale(k, scale);
+    BigDecimal result = arctan_by_pieces(std::move(x), scale, false).simple_mul(static_cast<uint64_t>(1) << halvings, 0);
+    result.round_by_scale(required_scale);
+    return result;
+}
+
+// artanh[1/m] = 1/m * (1 + 1/(3m^2) + 1/(5m^4) + ...), with only integers in the series
+BigDecimal artanh_inverse(const uint64_t m, const size_t scale) {
+    BigDecimal series = sum_series(BIG_DECIMAL_ONE, [](auto k) { return 2 * k - 1; },
+                                   [m](auto k) { return (2 * k + 1) * m * m; }, scale);
+    return series.simple_div_with_scale(m, scale);
+}
 
-        k += 2;
-        term = term * x_square;
-        term.round_by_scale(scale);
+// a constant computed once to the highest scale asked so far, where a lower scale is served by rounding it
+class CachedConstant {
+ private:
+    function<BigDecimal(size_t)> compute_;
+    BigDecimal value_;
+    size_t scale_;  // the scale of `value_`, 0 before it's computed
+
+ public:
+    explicit CachedConstant(function<BigDecimal(size_t)> compute)
+            : compute_(std::move(compute)), value_(BigInteger(), 0, true), scale_(0) {}
+
+    BigDecimal get(const size_t scale) {
+        // keep the extra digits, so the rounding for lower scales is as accurate as computing them directly
+        if (scale_ < scale + kExtraScale) {
+            value_ = compute_(scale + kExtraScale);
+            scale_ = scale + kExtraScale;
+        }
+        BigDecimal result = value_;
+        result.round_by_scale(scale);
+        return result;
+    }
+};
+
+// the terms [a, b) of the Chudnovsky series, with p(k) = -(6k-5)(2k-1)(6k-1), q(k) = k^3 * 640320^3 / 24 and the
+// terms multiplied by 13591409 + 545140134k
+SeriesSplit split_chudnovsky(const uint64_t a, const uint64_t b) {
+    if (b - a == 1) {
+        BigDecimal p = -BIG_DECIMAL_ONE.simple_mul((6 * a - 5) * (2 * a - 1), 0).simple_mul(6 * a - 1, 0);
+        BigDecimal q = BIG_DECIMAL_ONE.simple_mul(10939058860032000, 0).simple_mul(a * a, 0).simple_mul(a, 0);
+        BigDecimal t = p.simple_mul(13591409 + 545140134 * a, 0);
+        return {std::move(p), std::move(q), std::move(t)};
     }
-    result = result + arctan_02;
+
+    const uint64_t middle = a + (b - a) / 2;
+    return merge_splits(split_chudnovsky(a, middle), split_chudnovsky(middle, b));
+}
+
+// 1/pi = 12 / 640320^(3/2) * sum of (-1)^k (6k)! (13591409 + 545140134k) / ((3k)! (k!)^3 640320^(3k)), where every
+// term adds about 14.18 digits, so pi = 426880 * sqrt[10005] * q / (13591409 * q + t)
+BigDecimal chudnovsky_pi(const size_t required_scale) {
+    const size_t scale = required_scale + kExtraScale;
+    const auto count = static_cast<uint64_t>(static_cast<double>(scale) / 14.18) + 2;
+    SeriesSplit split = split_chudnovsky(1, count);
+
+    // q / (13591409 * q + t) is about 10^-8, so it needs more decimal digits
+    BigDecimal ratio = split.q.div_with_scale(split.q.simple_mul(13591409, 0) + split.t, scale + 10);
+    BigDecimal result = sqrt(BigDecimal("10005"), scale + 10).simple_mul(426880, 0) * ratio;
     result.round_by_scale(required_scale);
     return result;
 }
 
-// pi = 16 * arctan[1/5] - 4 * arctan[1/239]
 BigDecimal pi(const size_t scale) {
-    return BigDecimal("16") * arctan(BIG_DECIMAL_ZERO_TWO, scale)
-            - BigDecimal("4") * arctan(BIG_DECIMAL_ONE.simple_div_with_scale(239, scale), scale);
+    static CachedConstant cache(chudnovsky_pi);
+    return cache.get(scale);
 }
 
-// exp[x] = 1 + x + x^2/2 + x^3/6 + ...
-BigDecimal exp(const BigDecimal &x, const size_t scale) {
-    BigDecimal result = BIG_DECIMAL_ZERO;
-    BigDecimal term = BIG_DECIMAL_ONE;
-    uint64_t k = 1;
-    while (!term.is_zero()) {
-        result = result + term;
-        term = (term * x).simple_div_with_scale(k, scale + kExtraScale);
-        k++;
-    }
-    result.round_by_scale(scale);
-    return result;
+// e = 1 + 1 + 1/2 + 1/6 + ...
+BigDecimal euler_number(const size_t scale) {
+    static CachedConstant cache([](size_t required_scale) {
+        BigDecimal result = sum_series(BIG_DECIMAL_ONE, [](auto) { return 1; }, [](auto k) { return k; },
+                                       required_scale + kExtraScale);
+        result.round_by_scale(required_scale);
+        return result;
+    });
+    return cache.get(scale);
 }
 
-// ln[x] = 1 + ln[x / e]
-// formula: ln[1 + x] = x - x^2/2 + x^3/3 - ...
-BigDecimal ln(BigDecimal x, const size_t scale) {
-    int64_t count = 0;
-    BigDecimal e = exp(BIG_DECIMAL_ONE, scale + kExtraScale);
-    while (x > BIG_DECIMAL_THREEHALFS) {
-        x = x.div_with_scale(e, scale + kExtraScale);
-        count++;
+// ln[2] = 18 * artanh[1/26] - 2 * artanh[1/4801] + 8 * artanh[1/8749]
+BigDecimal ln_two(const size_t scale) {
+    static CachedConstant cache([](size_t required_scale) {
+        const size_t extended = required_scale + kExtraScale;
+        BigDecimal result = artanh_inverse(26, extended).simple_mul(18, 0)
+                - artanh_inverse(4801, extended).simple_mul(2, 0) + artanh_inverse(8749, extended).simple_mul(8, 0);
+        result.round_by_scale(required_scale);
+        return result;
+    });
+    return cache.get(scale);
+}
+
+// ln[10] = 3 * ln[2] + ln[5/4] = 3 * ln[2] + 2 * artanh[1/9]
+BigDecimal ln_ten(const size_t scale) {
+    static CachedConstant cache([](size_t required_scale) {
+        const size_t extended = required_scale + kExtraScale;
+        BigDecimal result = ln_two(extended).simple_mul(3, 0) + artanh_inverse(9, extended).simple_mul(2, 0);
+        result.round_by_scale(required_scale);
+        return result;
+    });
+    return cache.get(scale);
+}
+
+// sqrt[2pi], for the normal distribution
+BigDecimal sqrt_two_pi(const size_t scale) {
+    static CachedConstant cache([](size_t required_scale) {
+        return sqrt(pi(required_scale + kExtraScale).simple_mul(2, 0), required_scale);
+    });
+    return cache.get(scale);
+}
+
+// exp[x] = 1 + x + x^2/2 + x^3/6 + ..., where x is halved to below 1, summed piece by piece by exp[a + b] = exp[a]exp[b],
+// and squared back
+BigDecimal exp(const BigDecimal &x, const size_t required_scale) {
+    if (x.is_zero())
+        return BIG_DECIMAL_ONE;
+
+    // the result has about x * log10[e] integer digits, or that many leading zeros
+    if (x.most_significant_exponent() > 15) {
+        if (!x.positive())
+            return BIG_DECIMAL_ZERO;
+        throw runtime_error("the result of exp is too large");
     }
-    while (x < BIG_DECIMAL_HALF) {
-        x = x * e;
-        x.round_by_scale(scale + kExtraScale);
-        count--;
+    const double magnitude = std::ceil(to_double(x) * kLog10E);
+    if (magnitude < -static_cast<double>(required_scale) - 1)
+        return BIG_DECIMAL_ZERO;
+
+    size_t halvings;
+    BigDecimal y = halved_below_one(x, halvings);
+
+    // the significant digits the result needs, where every squaring at most doubles the relative error
+    const auto length = static_cast<size_t>(max(static_cast<double>(required_scale) + magnitude, 0.0))
+            + kExtraScale + kGuardDigits + halvings;
+    y.round_by_scale(length);
+
+    BigDecimal result = BIG_DECIMAL_ONE;
+    for (const BigDecimal &piece : burst_pieces(y, length)) {
+        result = result * sum_series(piece, [](auto) { return 1; }, [](auto k) { return k; }, length);
+        result.round_by_scale(length);
+    }
+    for (size_t i = 0; i < halvings; i++) {
+        result = result * result;
+        result.round_by_significant(length);
     }
+    result.round_by_scale(required_scale);
+    return result;
+}
 
-    BigDecimal result(to_string(count));
-    BigDecimal term = x - BIG_DECIMAL_ONE;
-    int64_t k = 1;
-    x = BIG_DECIMAL_ONE - x;  // multiplier
-    while (!term.is_zero()) {
-        result = result + term.simple_div_with_scale(k, scale + kExtraScale);
-        term = term * x;
-        term.round_by_scale(scale + kExtraScale);
-        k++;
+// ln[x] = k * ln[10] - j * ln[2] + ln[y], where x = y * 10^k / 2^j and 3/4 <= y < 3/2, and
+// ln[y] = 2 * artanh[(y - 1) / (y + 1)], where |(y - 1) / (y + 1)| < 1/5
+BigDecimal ln(BigDecimal x, const size_t required_scale) {
+    if (x <= BIG_DECIMAL_ZERO)
+        throw runtime_error("try to ln a non-positive number");
+
+    const size_t scale = required_scale + kExtraScale + kGuardDigits;
+    const int64_t k = x.most_significant_exponent();
+    BigDecimal y(BigInteger(x.mantissa()), x.exponent() - k, true);
+    const BigDecimal three_quarters("0.75");
+    uint64_t j = 0;
+    while (y < three_quarters) {
+        y = y.simple_mul(2, 0);
+        j++;
     }
-    result.round_by_scale(scale);
+    y.round_by_scale(scale);
+
+    BigDecimal result = arctan_by_pieces((y - BIG_DECIMAL_ONE).div_with_scale(y + BIG_DECIMAL_ONE, scale), scale, true)
+            .simple_mul(2, 0);
+    // k * ln[10] needs as many more digits as k has
+    if (k != 0)
+        result = result + BigDecimal(to_string(k)) * ln_ten(scale + to_string(k).size());
+    if (j != 0)
+        result = result - ln_two(scale).simple_mul(j, 0);
+    result.round_by_scale(required_scale);
     return result;
 }
 
+// phi[x] = 1/2 + 1/sqrt[2pi] * (x - x^3/(2*3) + x^5/(2*4*5) - ... + (-1)^n x^(2n+1)/(2^n n! (2n+1)) + ...)
 BigDecimal phi(const BigDecimal &x, const size_t required_scale) {
     size_t scale = required_scale + kExtraScale;
 
-    BigDecimal result = BIG_DECIMAL_ZERO;
-    BigDecimal term = x;
-    BigDecimal x_square = - x * x;
-    uint64_t k = 1;
-    while (!term.is_zero()) {
-        result = result + term.simple_div_with_scale(2 * k - 1, scale);
-        term = (term * x_square).simple_div_with_scale(2 * k, scale);
-        k++;
+    // 1 - phi[|x|] < exp[-x^2/2], so a large |x| rounds to 0 or 1, while its series needs about x^2 terms
+    if (x.most_significant_exponent() > 0) {
+        const double value = x.most_significant_exponent() > 15 ? 1e15 : to_double(x);
+        if (value * value / 2 * kLog10E > static_cast<double>(scale))
+            return x.positive() ? BIG_DECIMAL_ONE : BIG_DECIMAL_ZERO;
     }
 
-    BigDecimal coefficient_1 = BIG_DECIMAL_ONE.div_with_scale(sqrt(pi(scale).simple_mul(2, 0), scale), scale);
+    BigDecimal y = x;
+    y.round_by_scale(scale + kGuardDigits);
+    BigDecimal result = y * sum_series(- y * y, [](auto k) { return 2 * k - 1; },
+                                       [](auto k) { return 2 * k * (2 * k + 1); }, scale);
+
+    BigDecimal coefficient_1 = BIG_DECIMAL_ONE.div_with_scale(sqrt_two_pi(scale), scale);
 
     BigDecimal ret = BIG_DECIMAL_HALF + coefficient_1 * result;
     ret.round_by_scale(required_scale);
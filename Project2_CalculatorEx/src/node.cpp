@@ -40,7 +40,7 @@ BigDecimal BinOpNode::eval_wrapper(Context &context) {
 
 BigDecimal BinOpNode::eval(Context &context) {
     BigDecimal result = eval_wrapper(context);
-    if (!context.disabled_divergent_check() && result.mantissa().digits().size() > kDivergentLimit)
+    if (!context.disabled_divergent_check() && result.mantissa().digit_count() > kDivergentLimit)
         throw divergent_warning(range_, "divergent warning");
     return result;
 }
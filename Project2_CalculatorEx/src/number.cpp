@@ -1,8 +1,11 @@
 #include <algorithm>
+#include <cmath>
 #include <complex>
 #include <iostream>
 #include <iterator>
 #include <limits>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 
@@ -39,8 +42,61 @@ inline uint32_t uint32_bit_reverse(uint32_t t) {
     return t;
 }
 
+// process-wide cache of the roots of unity used by `FFTContext`, so that the O(n) `cos` / `sin` calls are paid only
+// once per process, instead of once per multiplication.
+//
+// only the table of the longest transform is kept, since e^{2 pi i k / n} = e^{2 pi i (k * N/n) / N}, a transform of
+// length n can read the table of length N with a stride of N / n. when a longer table is needed, the old one is reused
+// for the even entries, and it's still alive until the last context referring it is destroyed (`shared_ptr`).
+class FFTRootTable {
+ public:
+    using Table = vector<complex<double>>;
+
+ private:
+    inline static std::mutex mutex_;
+    inline static std::shared_ptr<const Table> roots_;  // roots_[k] = e^{2 pi i k / N}, for 0 <= k < N/2
+    inline static size_t memory_limit_ = std::numeric_limits<size_t>::max();
+
+    // build the table for length `n`, reusing `previous` (the table for length n / 2^j) if it's not null
+    static std::shared_ptr<const Table> build(uint32_t n, const Table *previous) {
+        auto table = std::make_shared<Table>(n >> 1);
+        uint32_t stride = previous == nullptr ? 0 : static_cast<uint32_t>(n / (previous->size() * 2));
+        for (uint32_t i = 0; i < (n >> 1); ++i) {
+            if (stride != 0 && i % stride == 0)
+                (*table)[i] = (*previous)[i / stride];
+            else
+                (*table)[i] = complex<double>(cos(2 * M_PI / n * i), sin(2 * M_PI / n * i));
+        }
+        return table;
+    }
+
+ public:
+    // get a table of length at least `n` (`n` should be a power of two)
+    static std::shared_ptr<const Table> get(uint32_t n) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (roots_ != nullptr && roots_->size() * 2 >= n)
+            return roots_;
+
+        // the table would exceed the memory limit, build a private one for the caller, but don't cache it
+        if ((n >> 1) * sizeof(complex<double>) > memory_limit_)
+            return build(n, nullptr);
+
+        roots_ = build(n, roots_.get());
+        return roots_;
+    }
+
+    // limit the bytes that the cached table can use, and drop the cached table if it's already too large
+    static void set_memory_limit(size_t bytes) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        memory_limit_ = bytes;
+        if (roots_ != nullptr && roots_->size() * sizeof(complex<double>) > memory_limit_)
+            roots_ = nullptr;
+    }
+};
+
 class FFTContext {
-    vector<complex<double>> omega_, omega_inverse_;
+    std::shared_ptr<const FFTRootTable::Table> roots_;
+    uint32_t stride_;  // e^{2 pi i k / n} is `(*roots_)[k * stride_]`
 
  public:
     uint32_t n_, k_ = 0;  // n is the maximum size, and n = 1 << k
@@ -51,15 +107,13 @@ class FFTContext {
             ++k_;
         n_ = 1U << k_;
 
-        omega_.reserve(n_ >> 1);
-        omega_inverse_.reserve(n_ >> 1);
-        for (uint32_t i = 0; i < (n_ >> 1); ++i)
-            omega_.emplace_back(cos(2 * M_PI / n_ * i), sin(2 * M_PI / n_ * i));
-        ::transform(omega_.begin(), omega_.end(), back_inserter(omega_inverse_),
-                  [](auto p) { return conj(p); });
+        roots_ = FFTRootTable::get(n_);
+        stride_ = static_cast<uint32_t>(roots_->size() * 2 / n_);
     }
 
-    void transform(vector<complex<double>> &a, const vector<complex<double>> &omega) const {
+    // inverse transform uses the conjugated roots, which is computed on the fly, so no extra table is needed
+    template<bool kInverse>
+    void transform(vector<complex<double>> &a) const {
         assert(a.size() == n_);
 
         for (uint32_t i = 0; i < n_; ++i) {
@@ -72,11 +126,13 @@ class FFTContext {
         }
 
         for (uint32_t i = 1; i <= k_; ++i) {
-            uint32_t omega_step = 1U << (k_ - i);
+            uint32_t half = 1U << (i - 1), omega_step = stride_ << (k_ - i);
             for (auto p = a.begin(); p != a.end(); p += 1U << i) {
-                auto l = p, r = p + (1U << (i - 1));
-                for (auto omega_iter = omega.begin(); omega_iter != omega.end(); ++l, ++r, omega_iter += omega_step) {
-                    complex<double> t = (*omega_iter) * (*r);
+                auto l = p, r = p + half;
+                auto omega_iter = roots_->begin();
+                for (uint32_t j = 0; j < half; ++j, ++l, ++r, omega_iter += omega_step) {
+                    complex<double> omega = kInverse ? conj(*omega_iter) : *omega_iter;
+                    complex<double> t = omega * (*r);
                     *r = *l - t;
                     *l += t;
                 }
@@ -85,16 +141,27 @@ class FFTContext {
     }
 
     void dft(vector<complex<double>> &a) const {
-        transform(a, omega_);
+        transform<false>(a);
     }
 
     void inverse_dft(vector<complex<double>> &a) const {
-        transform(a, omega_inverse_);
+        transform<true>(a);
         for (auto &p : a)
             p /= n_;
     }
 };
 
+// kPowersOfTen[k] = 10^k, for 0 <= k <= kLimbWidth
+constexpr uint32_t kPowersOfTen[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+// multiplications shorter than this (in limbs) are done by schoolbook, which has no transform to pay for
+constexpr size_t kFFTThreshold = 32;
+
+// the FFT splits every limb into three points of base 1000, so that the coefficients of the product (at most
+// n * 999^2) are still far from the precision of `double`
+constexpr size_t kPointsPerLimb = 3;
+constexpr uint32_t kPointBase = 1000;
+
 BigInteger::BigInteger(string_view number) {
     number.remove_prefix(min(number.size(), number.find_first_not_of('0')));  // remove leading zeros
 
@@ -104,101 +171,178 @@ BigInteger::BigInteger(string_view number) {
         throw number_parse_error("not digit (0 to 9)");
     }
 
-    // copy and transform digits to elements (`digits_`)
-    digits_.reserve(number.length());
-    transform(number.rbegin(), number.rend(), back_inserter(digits_), [](char digit) { return digit - '0'; });
+    // every `kLimbWidth` digits from the end make a limb
+    limbs_.reserve((number.length() + kLimbWidth - 1) / kLimbWidth);
+    for (size_t end = number.length(); end > 0; end -= min(end, kLimbWidth)) {
+        uint32_t limb = 0;
+        for (size_t i = end - min(end, kLimbWidth); i < end; ++i)
+            limb = limb * 10 + (number[i] - '0');
+        limbs_.push_back(limb);
+    }
 }
 
 void BigInteger::trim_leading_zeros() {
-    // find first non-zero digit (from end() to begin())
-    auto non_zero = find_if_not(digits_.rbegin(), digits_.rend(), [](auto digit) { return digit == 0; });
-    digits_.erase(digits_.end() - (non_zero - digits_.rbegin()), digits_.end());
+    // find first non-zero limb (from end() to begin())
+    auto non_zero = find_if_not(limbs_.rbegin(), limbs_.rend(), [](auto limb) { return limb == 0; });
+    limbs_.erase(limbs_.end() - (non_zero - limbs_.rbegin()), limbs_.end());
 }
 
 size_t BigInteger::trim_trailing_zeros() {
-    // find last non-zero digit
-    auto non_zero = find_if_not(digits_.begin(), digits_.end(), [](auto digit) { return digit == 0; });
-    size_t count = non_zero - digits_.begin();
-    digits_.erase(digits_.begin(), non_zero);  // then erase the leading zeros
+    // the zero limbs, and then the zero digits of the last non-zero limb
+    auto non_zero = find_if_not(limbs_.begin(), limbs_.end(), [](auto limb) { return limb == 0; });
+    if (non_zero == limbs_.end()) {
+        limbs_.clear();
+        return 0;
+    }
+    size_t count = (non_zero - limbs_.begin()) * kLimbWidth;
+    for (uint32_t limb = *non_zero; limb % 10 == 0; limb /= 10)
+        ++count;
+    shift_right_in_place(count);
     return count;
 }
 
+void BigInteger::shift_right_in_place(size_t length) {
+    const size_t whole = length / kLimbWidth;
+    if (whole >= limbs_.size()) {
+        limbs_.clear();
+        return;
+    }
+    limbs_.erase(limbs_.begin(), limbs_.begin() + whole);
+
+    // then every limb takes its high digits, and the low digits of the next limb
+    const uint32_t divisor = kPowersOfTen[length % kLimbWidth], multiplier = kLimbBase / divisor;
+    if (divisor != 1) {
+        for (size_t i = 0; i + 1 < limbs_.size(); ++i)
+            limbs_[i] = limbs_[i] / divisor + limbs_[i + 1] % divisor * multiplier;
+        limbs_.back() /= divisor;
+    }
+    trim_leading_zeros();
+}
+
 void BigInteger::add_one() {
-    int carry = 1;
-    for (auto &x : digits_) {
-        x += carry;
-        carry = x >= 10;
-        x -= carry ? 10 : 0;
+    for (auto &x : limbs_) {
+        if (++x < kLimbBase)
+            return;
+        x = 0;
     }
-    if (carry > 0)
-        digits_.push_back(carry);
+    limbs_.push_back(1);
 }
 
 string BigInteger::get_number_string() const {
-    string s;
+    if (limbs_.empty())
+        return "";
+
+    // the most significant limb without leading zeros, and the others with all their `kLimbWidth` digits
+    string s = std::to_string(limbs_.back());
+    s.reserve(s.size() + (limbs_.size() - 1) * kLimbWidth);
+    for (auto iter = limbs_.rbegin() + 1; iter != limbs_.rend(); ++iter) {
+        uint32_t limb = *iter;
+        s.append(kLimbWidth, '0');
+        for (auto p = s.rbegin(); limb != 0; ++p, limb /= 10)
+            *p = static_cast<char>('0' + limb % 10);
+    }
+    return s;
+}
 
-    // reserve the space then transform in reversed order
-    s.reserve(digits_.size());
-    transform(digits_.rbegin(), digits_.rend(), back_inserter(s), [](auto element) { return element + '0'; });
+size_t BigInteger::digit_count() const {
+    if (limbs_.empty())
+        return 0;
+    size_t count = (limbs_.size() - 1) * kLimbWidth;
+    for (uint32_t limb = limbs_.back(); limb != 0; limb /= 10)
+        ++count;
+    return count;
+}
 
-    return s;
+uint32_t BigInteger::digit(size_t index) const {
+    if (index / kLimbWidth >= limbs_.size())
+        return 0;
+    return limbs_[index / kLimbWidth] / kPowersOfTen[index % kLimbWidth] % 10;
 }
 
 BigInteger BigInteger::left_shift(size_t length) const {
+    if (limbs_.empty())
+        return *this;
+
+    // whole limbs of zeros, then the rest of the digits by multiplication
+    auto copy = *this * kPowersOfTen[length % kLimbWidth];
+    copy.limbs_.insert(copy.limbs_.begin(), length / kLimbWidth, 0);
+    return copy;
+}
+
+BigInteger BigInteger::right_shift(size_t length) const {
     auto copy = *this;
-    if (!digits_.empty())
-        copy.digits_.insert(copy.digits_.begin(), length, 0);
+    copy.shift_right_in_place(length);
     return copy;
 }
 
 BigInteger BigInteger::operator+(const BigInteger &other) const {
+    const BigInteger &longer = limbs_.size() >= other.limbs_.size() ? *this : other;
+    const BigInteger &shorter = &longer == this ? other : *this;
     BigInteger result;
-    result.digits_.resize(max(digits_.size(), other.digits_.size()) + 1);
-
-    // first, just put them together without handling the carry
-    copy(digits_.begin(), digits_.end(), result.digits_.begin());
-    transform(other.digits_.begin(), other.digits_.end(), result.digits_.begin(), result.digits_.begin(),
-              [](auto x, auto y) { return x + y; });
-
-    // then handle the carry by scanning the digits
-    int carry = 0;
-    for (auto &x : result.digits_) {
-        x += carry;
-        carry = x >= 10;
-        x -= carry ? 10 : 0;
+    result.limbs_.reserve(longer.limbs_.size() + 1);
+
+    // two limbs and a carry are less than 2 * kLimbBase < 2^32
+    uint32_t carry = 0;
+    for (size_t i = 0; i < longer.limbs_.size(); ++i) {
+        uint32_t x = longer.limbs_[i] + (i < shorter.limbs_.size() ? shorter.limbs_[i] : 0) + carry;
+        carry = x >= kLimbBase;
+        result.limbs_.push_back(carry ? x - kLimbBase : x);
     }
+    if (carry > 0)
+        result.limbs_.push_back(carry);
     return result;
 }
 
+// requires *this >= other
 BigInteger BigInteger::operator-(const BigInteger &other) const {
     BigInteger result;
-    result.digits_.resize(max(digits_.size(), other.digits_.size()));
-
-    // same as +, first put together without carry
-    copy(digits_.begin(), digits_.end(), result.digits_.begin());
-    transform(other.digits_.begin(), other.digits_.end(), result.digits_.begin(), result.digits_.begin(),
-              [](auto x, auto y) { return y - x; });
+    result.limbs_.reserve(limbs_.size());
 
-    int carry = 0;
-    for (auto &x : result.digits_) {
-        x -= carry;
-        carry = x > 10;  // since `digits_` is unsigned, so negative number will underflow to a very large number
-        x += carry ? 10 : 0;
+    uint32_t borrow = 0;
+    for (size_t i = 0; i < limbs_.size(); ++i) {
+        uint32_t y = (i < other.limbs_.size() ? other.limbs_[i] : 0) + borrow;
+        borrow = limbs_[i] < y;
+        result.limbs_.push_back(borrow ? limbs_[i] + kLimbBase - y : limbs_[i] - y);
     }
+    result.trim_leading_zeros();
     return result;
 }
 
 BigInteger BigInteger::operator*(const BigInteger &other) const {
     BigInteger result;
+    if (limbs_.empty() || other.limbs_.empty())
+        return result;
+
+    const size_t n = limbs_.size(), m = other.limbs_.size();
+    if (min(n, m) < kFFTThreshold) {
+        // schoolbook: a limb of the result, a product and a carry are less than kLimbBase^2 + 2 kLimbBase < 2^64
+        result.limbs_.assign(n + m, 0);
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t carry = 0;
+            for (size_t j = 0; j < m; ++j) {
+                carry += result.limbs_[i + j] + static_cast<uint64_t>(limbs_[i]) * other.limbs_[j];
+                result.limbs_[i + j] = static_cast<uint32_t>(carry % kLimbBase);
+                carry /= kLimbBase;
+            }
+            result.limbs_[i + m] = static_cast<uint32_t>(carry);
+        }
+        result.trim_leading_zeros();
+        return result;
+    }
 
     // prepare FFT context:
     // for two numbers with length `x` and `y`, the length of the multiplication result will be at most `x + y`
-    FFTContext context(digits_.size() + other.digits_.size());
+    FFTContext context(static_cast<uint32_t>((n + m) * kPointsPerLimb));
     vector <complex<double>> lhs(context.n_), rhs(context.n_);
 
-    // copy the digits to FFT coefficients:
-    copy(digits_.begin(), digits_.end(), lhs.begin());
-    copy(other.digits_.begin(), other.digits_.end(), rhs.begin());
+    // copy the limbs to FFT coefficients, `kPointsPerLimb` points of base `kPointBase` per limb
+    const auto split = [](const vector<uint32_t> &limbs, vector<complex<double>> &points) {
+        for (size_t i = 0; i < limbs.size(); ++i)
+            for (uint32_t k = 0, limb = limbs[i]; k < kPointsPerLimb; ++k, limb /= kPointBase)
+                points[i * kPointsPerLimb + k] = limb % kPointBase;
+    };
+    split(limbs_, lhs);
+    split(other.limbs_, rhs);
 
     // multiply via FFT:
     // first we transform the polynomial from coefficient representation to point-value representation by DFT
@@ -209,14 +353,15 @@ BigInteger BigInteger::operator*(const BigInteger &other) const {
     // next we transform the polynomial from point-value representation back to coefficient representation by I-DFT
     context.inverse_dft(lhs);
 
-    // collect results from the polynomial, or you can just think that substituting x = 10 into the polynomial to
-    // calculate the value
-    result.digits_.reserve(context.n_);
+    // collect results from the polynomial, or you can just think that substituting x = kPointBase into the polynomial
+    // to calculate the value, and every `kPointsPerLimb` points are combined back into a limb
+    result.limbs_.assign(n + m, 0);
     int64_t carry = 0;
-    for (const auto &p : lhs) {
-        carry += static_cast<decltype(carry)>(round(p.real()));
-        result.digits_.push_back(static_cast<decltype(digits_[0])>(carry % 10));
-        carry /= 10;
+    for (size_t i = 0; i < (n + m) * kPointsPerLimb; ++i) {
+        carry += static_cast<decltype(carry)>(round(lhs[i].real()));
+        result.limbs_[i / kPointsPerLimb] += static_cast<uint32_t>(carry % kPointBase) *
+                                             kPowersOfTen[i % kPointsPerLimb * 3];
+        carry /= kPointBase;
     }
 
     result.trim_leading_zeros();  // standardization
@@ -225,34 +370,53 @@ BigInteger BigInteger::operator*(const BigInteger &other) const {
 
 // simple multiplication with integer rhs
 BigInteger BigInteger::operator*(const uint64_t rhs) const {
+    // a limb times `rhs` doesn't fit in 64 bits any more, so it's multiplied as a `BigInteger`
+    if (rhs >= kLimbBase)
+        return *this * BigInteger({static_cast<uint32_t>(rhs % kLimbBase),
+                                   static_cast<uint32_t>(rhs / kLimbBase % kLimbBase),
+                                   static_cast<uint32_t>(rhs / kLimbBase / kLimbBase)});
+
     BigInteger result = *this;
     uint64_t carry = 0;
 
-    // apply the multiplier to all the digits
-    for (auto &x : result.digits_) {
+    // apply the multiplier to all the limbs
+    for (auto &x : result.limbs_) {
         carry += x * rhs;
-        x = carry % 10;
-        carry /= 10;
+        x = static_cast<uint32_t>(carry % kLimbBase);
+        carry /= kLimbBase;
     }
 
-    // if carry is not zero, we need to "add" some digits
-    while (carry > 0) {
-        result.digits_.push_back(carry % 10);
-        carry /= 10;
-    }
+    // if carry is not zero, we need to "add" a limb
+    if (carry > 0)
+        result.limbs_.push_back(static_cast<uint32_t>(carry));
+    if (rhs == 0)
+        result.limbs_.clear();
 
     return result;
 }
 
-// simple division with integer rhs
+// simple division with integer rhs, rounded to the nearest
 BigInteger BigInteger::operator/(const uint64_t rhs) const {
     BigInteger result = *this;
 
+    // the remainder times `kLimbBase` must fit in 64 bits, otherwise divide digit by digit
     uint64_t dividend = 0;
-    for (auto iter = result.digits_.rbegin(); iter != result.digits_.rend(); ++iter) {
-        dividend = dividend * 10 + (*iter);
-        *iter = dividend / rhs;
-        dividend %= rhs;
+    if (rhs < (1ULL << 32)) {
+        for (auto iter = result.limbs_.rbegin(); iter != result.limbs_.rend(); ++iter) {
+            dividend = dividend * kLimbBase + (*iter);
+            *iter = static_cast<uint32_t>(dividend / rhs);
+            dividend %= rhs;
+        }
+    } else {
+        for (auto iter = result.limbs_.rbegin(); iter != result.limbs_.rend(); ++iter) {
+            uint32_t quotient = 0;
+            for (int k = kLimbWidth - 1; k >= 0; --k) {
+                dividend = dividend * 10 + (*iter) / kPowersOfTen[k] % 10;
+                quotient = quotient * 10 + static_cast<uint32_t>(dividend / rhs);
+                dividend %= rhs;
+            }
+            *iter = quotient;
+        }
     }
 
     // round
@@ -264,9 +428,9 @@ BigInteger BigInteger::operator/(const uint64_t rhs) const {
 }
 
 bool BigInteger::operator<(const BigInteger &other) const {
-    if (digits_.size() != other.digits_.size())
-        return digits_.size() < other.digits_.size();
-    return lexicographical_compare(digits_.rbegin(), digits_.rend(), other.digits_.rbegin(), other.digits_.rend());
+    if (limbs_.size() != other.limbs_.size())
+        return limbs_.size() < other.limbs_.size();
+    return lexicographical_compare(limbs_.rbegin(), limbs_.rend(), other.limbs_.rbegin(), other.limbs_.rend());
 }
 
 BigDecimal::BigDecimal(string_view number) : positive_(true) {
@@ -335,7 +499,16 @@ int64_t BigDecimal::most_significant_exponent() const {
     if (is_zero())
         return std::numeric_limits<int64_t>::min();  // 0 => -INF
 
-    return mantissa_.digits_.size() + exponent_;
+    return static_cast<int64_t>(mantissa_.digit_count()) + exponent_;
+}
+
+double BigDecimal::leading_value() const {
+    const size_t count = mantissa_.digit_count(), top_count = min(count, static_cast<size_t>(18));
+    const BigInteger top = mantissa_.right_shift(count - top_count);
+    uint64_t value = 0;
+    for (auto iter = top.limbs_.rbegin(); iter != top.limbs_.rend(); ++iter)
+        value = value * kLimbBase + *iter;
+    return static_cast<double>(value) / pow(10.0, static_cast<double>(top_count));
 }
 
 void BigDecimal::standardize() {
@@ -349,31 +522,32 @@ void BigDecimal::standardize() {
 }
 
 void BigDecimal::round_by_significant(size_t length) {
-    if (mantissa_.digits_.size() <= length)
+    const size_t count = mantissa_.digit_count();
+    if (count <= length)
         return;
 
     // update the exponent
-    exponent_ += mantissa_.digits_.size() - length;
+    exponent_ += count - length;
 
     // save it so we can round it later
-    auto last_digit = *(mantissa_.digits_.end() - length - 1);
+    auto last_digit = mantissa_.digit(count - length - 1);
 
     // remove redundant digits
-    mantissa_.digits_.erase(mantissa_.digits_.begin(), mantissa_.digits_.end() - length);
+    mantissa_.shift_right_in_place(count - length);
 
     if (last_digit >= 5)  // round
         mantissa_.add_one();
 
     // if `add_one` adds a digit, then we need to erase one more digit
-    if (mantissa_.digits_.size() > length) {
-        auto last_digit_2 = mantissa_.digits_[0];
-        mantissa_.digits_.erase(mantissa_.digits_.begin());
+    if (mantissa_.digit_count() > length) {
+        auto last_digit_2 = mantissa_.digit(0);
+        mantissa_.shift_right_in_place(1);
         if (last_digit_2 >= 5)  // round
             mantissa_.add_one();  // by simple analysis, this won't add a digit
         exponent_ += 1;
     }
 
-    assert(mantissa_.digits_.size() <= length);
+    assert(mantissa_.digit_count() <= length);
     standardize();
 }
 
@@ -394,7 +568,7 @@ void BigDecimal::drop_decimal() {
     if (exponent_ >= 0)
         return;
 
-    mantissa_.digits_.erase(mantissa_.digits_.begin(), mantissa_.digits_.begin() + (-exponent_));
+    mantissa_.shift_right_in_place(static_cast<size_t>(-exponent_));
     exponent_ = 0;
     standardize();
 }
@@ -520,22 +694,56 @@ BigDecimal BigDecimal::div_with_scale(const BigDecimal &other, size_t scale) con
 }
 */
 
-// we first calculate `1/rhs` using Newton's Method
-//    calculate by resolving f(x) = 1/x - rhs = 0
-//    Newton's iteration: x <= (2 - x * rhs) * x (with a good initial)
-// then use it to calculate `*this * (1/rhs)` to get the result
+BigDecimal rounded_to_significant(BigDecimal x, size_t length) {
+    x.round_by_significant(length);
+    return x;
+}
+
+// 1 / x to `length` significant digits, by Newton's iteration y <- y + y * (1 - x * y), which doubles the correct
+// digits of y every step. so every step only needs twice the digits of the previous one (x and y are rounded to
+// them), and the whole iteration costs about two multiplications of the last length
+BigDecimal reciprocal(const BigDecimal &x, const size_t length) {
+    // the initial value from x = 0.d1d2d3... * 10^e, as 1/x = 1/(0.d1d2d3...) * 10^-e
+    BigDecimal y(BigInteger(std::to_string(llround(1e15 / x.leading_value()))), -15 - x.most_significant_exponent(),
+                 x.positive());
+
+    for (size_t correct = kSeedDigits; correct < length;) {
+        const size_t next = min(2 * correct, length);
+
+        // 1 - x * y is about 10^-correct, so its leading `next - correct` digits are enough
+        BigDecimal error = BIG_DECIMAL_ONE - rounded_to_significant(x, next + kGuardDigits) * y;
+        BigDecimal delta = y * rounded_to_significant(std::move(error), next - correct + kGuardDigits);
+        y = rounded_to_significant(y + rounded_to_significant(std::move(delta), next - correct + kGuardDigits),
+                                   next + kGuardDigits);
+        correct = next;
+    }
+    return y;
+}
+
+// the quotient needs the digits of its integer part and `scale` (and `kExtraScale`) decimal digits, that is, `length`
+// significant digits. it's computed from a reciprocal of half of them (Karp-Markstein):
+//     q0 = *this * (1/rhs), which is correct to half of the digits
+//     q = q0 + (1/rhs) * (*this - q0 * rhs)
+// the remainder is tiny, so its product with the half-length reciprocal corrects the other half, and the whole
+// division costs a few multiplications at the final length, instead of a long Newton's iteration
 BigDecimal BigDecimal::div_with_scale(const BigDecimal &rhs, const size_t scale) const {
     if (rhs.mantissa_.is_zero())
         throw runtime_error("div by zero");
 
-    size_t div_scale = max(static_cast<int64_t>(0), most_significant_exponent() + static_cast<int64_t>(scale + kExtraScale));
+    // the quotient is less than 10^(its integer digits), and if that's not in the scale, it's rounded to zero
+    const int64_t integer_digits = is_zero() ? 0 : most_significant_exponent() - rhs.most_significant_exponent() + 1;
+    if (is_zero() || integer_digits + static_cast<int64_t>(scale + kExtraScale) <= 0)
+        return BIG_DECIMAL_ZERO;
+    const auto length = static_cast<size_t>(integer_digits + static_cast<int64_t>(scale + kExtraScale)) + kGuardDigits;
+    const size_t half = length / 2 + kGuardDigits;
 
-    // as rhs = "m * 10^n", use "1 * 10^{-n}" as initial
-    BigDecimal initial(BigInteger({1}), - rhs.most_significant_exponent(), rhs.positive_);
+    const BigDecimal lhs = rounded_to_significant(*this, length + kGuardDigits);
+    const BigDecimal divisor = rounded_to_significant(rhs, length + kGuardDigits);
+    const BigDecimal inv = reciprocal(divisor, half);
 
-    BigDecimal inv = newtons_method([&rhs](auto &x) { return (BIG_DECIMAL_TWO - x * rhs) * x; },
-                                    std::move(initial), div_scale);
-    BigDecimal result = *this * inv;
+    BigDecimal result = rounded_to_significant(lhs * inv, half);
+    BigDecimal remainder = rounded_to_significant(lhs - result * divisor, half);
+    result = result + rounded_to_significant(remainder * inv, half);
     result.round_by_scale(scale);
     return result;
 }
@@ -565,8 +773,18 @@ bool BigDecimal::operator<(const BigDecimal &other) const {
         return positive_ < other.positive_;
     if (most_significant_exponent() != other.most_significant_exponent())
         return most_significant_exponent() < other.most_significant_exponent();
-    return lexicographical_compare(mantissa_.digits_.rbegin(), mantissa_.digits_.rend(),
-                                   other.mantissa_.digits_.rbegin(), other.mantissa_.digits_.rend());
+
+    // the same most significant digit, so compare the digits from there. the limbs are aligned differently if the
+    // lengths are different, so it's digit by digit then, which usually ends in the first few digits
+    const size_t count = mantissa_.digit_count(), other_count = other.mantissa_.digit_count();
+    if (count == other_count)
+        return mantissa_ < other.mantissa_;
+    for (size_t i = 1; i <= min(count, other_count); ++i) {
+        const uint32_t digit = mantissa_.digit(count - i), other_digit = other.mantissa_.digit(other_count - i);
+        if (digit != other_digit)
+            return digit < other_digit;
+    }
+    return count < other_count;
 }
 
 bool BigDecimal::operator==(const BigDecimal &rhs) const {
@@ -577,7 +795,7 @@ bool BigDecimal::operator==(const BigDecimal &rhs) const {
 
 ostream &operator<<(ostream &stream, const BigDecimal &decimal) {
     // special condition for 0
-    if (decimal.mantissa_.digits().empty())
+    if (decimal.mantissa_.is_zero())
         return stream << '0';
 
     // serialize `mantissa` to string, then make it into `string_view`, so that we can easily cut the slice
@@ -586,7 +804,7 @@ ostream &operator<<(ostream &stream, const BigDecimal &decimal) {
 
     // assert that it's at least one non-zero digits, that is, return value of `find_first_not_of` won't be `npos`
     // because every `BigDecimal` instance is well trimmed, so if all the digits are zero, then it will be trimmed to
-    // empty (`digits_` is empty), and this case is already handled by the if on the head of this function,
+    // empty (`limbs_` is empty), and this case is already handled by the if on the head of this function,
     // so here there are at least one non-zero digits.
     assert(mantissa_view.find_first_not_of('0') != string::npos);
     // standardize leading zeros of `mantissa_view`
@@ -8,26 +8,34 @@
 
 class BigDecimal;
 
+// one element of `BigInteger::limbs_` is `kLimbWidth` decimal digits, that is, it's in base `kLimbBase`
+constexpr size_t kLimbWidth = 9;
+constexpr uint32_t kLimbBase = 1000000000;
+
 class BigInteger {
  private:
-    std::vector<uint8_t> digits_;  // one element is `kDigitWidth` digits
+    std::vector<uint32_t> limbs_;  // from the least significant limb, without leading zero limbs
+
+    void shift_right_in_place(size_t length);  // *this <- floor(*this / 10^length)
 
  public:
-    BigInteger() : digits_() {}
-    explicit BigInteger(std::vector<uint8_t> &&digits) : digits_(digits) { trim_leading_zeros(); }
+    BigInteger() : limbs_() {}
+    explicit BigInteger(std::vector<uint32_t> &&limbs) : limbs_(limbs) { trim_leading_zeros(); }
     explicit BigInteger(std::string_view number);
 
     void trim_leading_zeros();  // standardize leading zero elements
-    size_t trim_trailing_zeros();  // standardize trailing zero elements and return deleted number
+    size_t trim_trailing_zeros();  // standardize trailing zero (decimal) digits and return deleted number
     void add_one();  // add 1 to the BigInteger
 
-    // get string representation of the integer, and the length of the string must be a multiple of 4
-    // note: there may be several leading or trailing zeros, since it's expensive to standardize single zeros
+    // get string representation of the integer, without leading zeros
     [[nodiscard]] std::string get_number_string() const;
-    [[nodiscard]] const std::vector<uint8_t> &digits() const { return digits_; }
-    [[nodiscard]] bool is_zero() const { return digits_.empty(); }
+    [[nodiscard]] const std::vector<uint32_t> &limbs() const { return limbs_; }
+    [[nodiscard]] size_t digit_count() const;  // number of decimal digits, 0 for zero
+    [[nodiscard]] uint32_t digit(size_t index) const;  // the decimal digit of 10^index
+    [[nodiscard]] bool is_zero() const { return limbs_.empty(); }
 
     [[nodiscard]] BigInteger left_shift(size_t length) const;  // returns *this * 10^length (i.e. left shift in base 10)
+    [[nodiscard]] BigInteger right_shift(size_t length) const;  // returns floor(*this / 10^length)
     BigInteger operator+(const BigInteger &other) const;
     BigInteger operator-(const BigInteger &other) const;
     BigInteger operator*(const BigInteger &other) const;
@@ -39,7 +47,7 @@ class BigInteger {
     bool operator<=(const BigInteger &rhs) const { return !(rhs < *this); }
     bool operator>=(const BigInteger &rhs) const { return !(*this < rhs); }
 
-    bool operator==(const BigInteger &rhs) const { return digits_ == rhs.digits_; }
+    bool operator==(const BigInteger &rhs) const { return limbs_ == rhs.limbs_; }
     bool operator!=(const BigInteger &rhs) const { return !(rhs == *this); }
 
     friend class BigDecimal;
@@ -62,6 +70,7 @@ class BigDecimal {
     [[nodiscard]] bool positive() const { return positive_; }
     [[nodiscard]] bool is_zero() const { return mantissa_.is_zero(); }
     [[nodiscard]] int64_t most_significant_exponent() const;
+    [[nodiscard]] double leading_value() const;  // the leading digits as 0.d1d2d3..., ignoring the sign and exponent
 
     void standardize();  // by standardization, every unique is mapped to a unique BigDecimal, make it easy to compare
     void round_by_significant(size_t length);  // round, so that len(mantissa_) <= length
@@ -92,4 +101,7 @@ class BigDecimal {
 
 std::ostream &operator<<(std::ostream &stream, const BigDecimal &decimal);
 
+// `x` rounded to `length` significant digits
+BigDecimal rounded_to_significant(BigDecimal x, size_t length);
+
 #endif  // CALCULATOR_SRC_NUMBER_H
@@ -2,6 +2,7 @@
 #include "test.hpp"
 #include "error.h"
 #include "constant.h"
+#include "eval.h"
 
 TEST(DecimalTest, ParsingTest) {
     EXPECT_EQ(big_decimal_string(BigDecimal("12345.6789")), "12345.6789");
@@ -89,6 +90,97 @@ TEST(DecimalTest, DivideWithIndivisibleTest) {
     EXPECT_EQ(BigDecimal("2398048012").div_with_scale(BigDecimal("3425309249037"), 100), BigDecimal("0.0007000967905815199632938263091579117230711559808264095306243757050524047730771946493512486346525507"));
 }
 
+TEST(DecimalTest, DivideLongTest) {
+    // the reciprocal is refined from the initial 14 digits to thousands of them
+    std::string sevenths = "0.";
+    for (int i = 0; i < 500; i++)
+        sevenths += "142857";
+    EXPECT_EQ(BigDecimal("1").div_with_scale(BigDecimal("7"), 3000), BigDecimal(sevenths));
+    EXPECT_EQ(BigDecimal("-22").div_with_scale(BigDecimal("7"), 3000), BigDecimal("-3" + sevenths.substr(1)));
+
+    // exact quotients of long operands
+    for (size_t n : {10, 100, 1000, 5000}) {
+        BigDecimal a = get_decimal(n), b = get_decimal(n / 2 + 1);
+        if (b.is_zero())
+            continue;
+        EXPECT_EQ((a * b).div_with_scale(b, 0), a);
+    }
+}
+
+TEST(DecimalTest, SqrtTest) {
+    EXPECT_EQ(sqrt(BigDecimal("2"), 9), BigDecimal("1.414213562"));
+    EXPECT_EQ(sqrt(BigDecimal("0.0004"), 5), BigDecimal("0.02"));
+    EXPECT_EQ(sqrt(BigDecimal("1e-30"), 10), BigDecimal("0"));
+    EXPECT_EQ(sqrt(BigDecimal("0"), 10), BigDecimal("0"));
+    EXPECT_THROW(sqrt(BigDecimal("-1"), 10), runtime_error);
+
+    // the inverse square root is refined from the initial 14 digits, and the result is between its neighbours
+    const BigDecimal two("2"), ulp("1e-3000"), root = sqrt(two, 3000);
+    EXPECT_LT((root - ulp) * (root - ulp), two);
+    EXPECT_LT(two, (root + ulp) * (root + ulp));
+
+    // exact roots of long perfect squares
+    for (size_t n : {10, 100, 1000, 5000}) {
+        BigDecimal a = get_decimal(n);
+        if (a < BIG_DECIMAL_ZERO)
+            a = BIG_DECIMAL_ZERO - a;
+        EXPECT_EQ(sqrt(a * a, 0), a);
+    }
+}
+
+TEST(DecimalTest, SeriesTest) {
+    EXPECT_EQ(pi(50), BigDecimal("3.14159265358979323846264338327950288419716939937511"));
+    EXPECT_EQ(exp(BigDecimal("1"), 50), BigDecimal("2.71828182845904523536028747135266249775724709369996"));
+    EXPECT_EQ(sin(BigDecimal("100"), 30), BigDecimal("-0.506365641109758793656557610460"));
+    EXPECT_EQ(exp(BigDecimal("-50"), 30), BigDecimal("0.000000000000000000000192874985"));
+    EXPECT_EQ(arctan(BigDecimal("1000000"), 30), BigDecimal("1.570795326794896619564655024973"));
+    EXPECT_EQ(phi(BigDecimal("-3"), 30), BigDecimal("0.001349898031630094526651814768"));
+    EXPECT_EQ(phi(BigDecimal("40"), 30), BigDecimal("1"));
+
+    // long arguments are summed piece by piece, and the identities hold to the last digits
+    const size_t scale = 2000;
+    const BigDecimal x = sqrt(BigDecimal("2"), scale), ulp("1e-1990");
+    const BigDecimal sin_x = sin(x, scale), cos_x = cos(x, scale);
+    EXPECT_LT(BigDecimal("1") - (sin_x * sin_x + cos_x * cos_x), ulp);
+    EXPECT_LT(sin_x * sin_x + cos_x * cos_x - BigDecimal("1"), ulp);
+    const BigDecimal product = exp(x, scale) * exp(-x, scale);
+    EXPECT_LT(BigDecimal("1") - product, ulp);
+    EXPECT_LT(product - BigDecimal("1"), ulp);
+    const BigDecimal difference = arctan(BigDecimal("1"), scale).simple_mul(4, 0) - pi(scale);
+    EXPECT_LT(difference, ulp);
+    EXPECT_LT(-difference, ulp);
+
+    // phi[sqrt[2]] = (1 + erf[1]) / 2, and its derivative is exp[-x^2/2] / sqrt[2pi], where the difference quotient
+    // divides the rounding by the step, so it's 1300 digits
+    EXPECT_EQ(phi(sqrt(BigDecimal("2"), 100), 100), BigDecimal("0.92135039647485743467061031754130462964803349898315"
+                                                               "14542299689489173586270480054206309916626740724442"));
+    const BigDecimal step("1e-700");
+    const BigDecimal slope = (phi(x + step, scale) - phi(x - step, scale)).div_with_scale(step.simple_mul(2, 0), scale);
+    const BigDecimal density = exp(BigDecimal("-1"), scale).div_with_scale(sqrt(pi(scale).simple_mul(2, 0), scale),
+                                                                           scale);
+    EXPECT_LT(slope - density, BigDecimal("1e-1290"));
+    EXPECT_LT(density - slope, BigDecimal("1e-1290"));
+}
+
+TEST(DecimalTest, ConstantTest) {
+    // a lower scale is rounded from the cached higher one, and a higher one extends it
+    const BigDecimal pi_1000 = pi(1000);
+    EXPECT_EQ(pi(20), BigDecimal("3.14159265358979323846"));
+    EXPECT_EQ(pi(9), BigDecimal("3.141592654"));
+    EXPECT_EQ(pi(1000), pi_1000);
+    const BigDecimal pi_1500 = pi(1500);
+    EXPECT_LT(pi_1000 - pi_1500, BigDecimal("1e-1000"));
+    EXPECT_LT(pi_1500 - pi_1000, BigDecimal("1e-1000"));
+
+    EXPECT_EQ(euler_number(50), BigDecimal("2.71828182845904523536028747135266249775724709369996"));
+    EXPECT_EQ(ln(BigDecimal("10"), 50), BigDecimal("2.30258509299404568401799145468436420760110148862877"));
+    EXPECT_EQ(ln(BigDecimal("2"), 50), BigDecimal("0.69314718055994530941723212145817656807550013436026"));
+    EXPECT_EQ(ln(BigDecimal("0.001"), 50), BigDecimal("-6.90775527898213705205397436405309262280330446588632"));
+    EXPECT_EQ(ln(BigDecimal("1"), 50), BigDecimal("0"));
+    EXPECT_THROW(ln(BigDecimal("0"), 10), runtime_error);
+    EXPECT_THROW(ln(BigDecimal("-2"), 10), runtime_error);
+}
+
 TEST(DecimalTest, SimpleDivideTest) {
     EXPECT_EQ(BigDecimal("4").simple_div_with_scale(1, 10), BigDecimal("4"));
     EXPECT_EQ(BigDecimal("4").simple_div_with_scale(2, 10), BigDecimal("2"));
@@ -120,19 +212,48 @@ TEST(DecimalTest, CompareTest) {
     EXPECT_LE(BigDecimal("114.514"), BigDecimal("114.52"));
 }
 
+TEST(DecimalTest, LimbBoundaryTest) {
+    // the digits cross the limbs of 9 digits in the rounding, shifts and carries
+    const auto rounded = [](auto d, size_t length) { d.round_by_significant(length); return d; };
+    EXPECT_EQ(rounded(BigDecimal("1234567891.5"), 10), BigDecimal("1234567892"));
+    EXPECT_EQ(rounded(BigDecimal("999999999999999999.5"), 18), BigDecimal("1000000000000000000"));
+    EXPECT_EQ(rounded(BigDecimal("0.1234567890123456789"), 9), BigDecimal("0.123456789"));
+    EXPECT_EQ(rounded(BigDecimal("987654321"), 0), BigDecimal("0"));
+
+    const auto floor = [](auto d) { d.drop_decimal(); return d; };
+    EXPECT_EQ(floor(BigDecimal("12345678901234567890.12345678901")), BigDecimal("12345678901234567890"));
+    EXPECT_EQ(floor(BigDecimal("0.999999999999")), BigDecimal("0"));
+
+    EXPECT_EQ(BigDecimal("999999999.999999999") + BigDecimal("0.000000001"), BigDecimal("1000000000"));
+    EXPECT_EQ(BigDecimal("1000000000000000000") - BigDecimal("0.000000001"), BigDecimal("999999999999999999.999999999"));
+    EXPECT_EQ(BigDecimal("123456789e20").simple_mul(1000000007, 0), BigDecimal("123456789864197523e20"));
+    EXPECT_EQ(BigDecimal("1e30").simple_div_with_scale(7, 5), BigDecimal("142857142857142857142857142857.14286"));
+    EXPECT_EQ(BigDecimal("5").simple_mul(123456789123456789, 0), BigDecimal("617283945617283945"));
+
+    EXPECT_LT(BigDecimal("1.23456789"), BigDecimal("1.234567891"));
+    EXPECT_LT(BigDecimal("1.2345678909"), BigDecimal("1.234567891"));
+    EXPECT_EQ(big_decimal_string(BigDecimal("1000000001000000001e-9")), "1000000001.000000001");
+
+    // long products go through the FFT, (10^n - 1)^2 = 99...9800...01 has the largest possible points
+    for (size_t n : {8, 9, 10, 300, 1000, 5000}) {
+        BigDecimal nines(std::string(n, '9'));
+        EXPECT_EQ(big_decimal_string(nines * nines), std::string(n - 1, '9') + "8" + std::string(n - 1, '0') + "1");
+    }
+}
+
 TEST(DecimalTest, ZeroTests) {
     for (int i = 0; i < 100; i++) {
         BigDecimal d = get_decimal(100);
         BigDecimal e = BIG_DECIMAL_ZERO - d;
 
         // everything except `positive_` should be identical
-        EXPECT_EQ(d.mantissa().digits(), e.mantissa().digits());
+        EXPECT_EQ(d.mantissa().limbs(), e.mantissa().limbs());
         EXPECT_EQ(d.exponent(), e.exponent());
         EXPECT_EQ(d.positive(), !e.positive());
 
         BigDecimal z = d + e;
         EXPECT_EQ(z, BIG_DECIMAL_ZERO);
-        EXPECT_EQ(z.mantissa().digits().empty(), true);
+        EXPECT_EQ(z.mantissa().limbs().empty(), true);
 
         EXPECT_EQ(d + BIG_DECIMAL_ZERO, d);
         EXPECT_EQ(d - BIG_DECIMAL_ZERO, d);